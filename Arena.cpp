@@ -0,0 +1,247 @@
+#pragma once
+#include "stdafx.h"
+
+//Monotonic bump allocator: objects are carved out of big blocks and all the memory is freed at once
+class Arena
+{
+private:
+    //Header placed at the beginning of every block
+    struct Block
+    {
+        Block* prev;
+        size_t size;
+    };
+
+    //Fields
+    const size_t _init_Block_size;
+    const size_t _max_Block_size = size_t(1) << 26;
+    size_t _next_Block_size;
+    Block* _head = nullptr;
+    std::byte* _cur = nullptr;
+    std::byte* _end = nullptr;
+    size_t _bytes_used = 0;
+
+    //Private methods
+
+    //Chain a new block that is able to hold at least _Size bytes aligned to _Align
+    void _new_Block(size_t _Size, size_t _Align)
+    {
+        size_t size = std::max(this->_next_Block_size, sizeof(Block) + _Size + _Align);
+        auto block = static_cast<Block*>(::operator new(size));
+
+        block->prev = this->_head;
+        block->size = size;
+
+        this->_head = block;
+        this->_cur = reinterpret_cast<std::byte*>(block) + sizeof(Block);
+        this->_end = reinterpret_cast<std::byte*>(block) + size;
+
+        //Grow geometrically so the number of blocks stays logarithmic
+        this->_next_Block_size = std::min(this->_next_Block_size << 1, this->_max_Block_size);
+    }
+
+    //Free blocks starting from _First, following the chain to the oldest one
+    static void _free_Blocks(Block* _First) noexcept
+    {
+        while (_First)
+        {
+            Block* prev = _First->prev;
+            ::operator delete(_First);
+            _First = prev;
+        }
+    }
+
+public:
+    //Constructors
+    explicit Arena(size_t _Block_Size = 4096) noexcept
+        : _init_Block_size(_Block_Size), _next_Block_size(_Block_Size)
+    { }
+
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+
+    ~Arena()
+    {
+        this->release();
+    }
+
+    //Get raw memory for _Size bytes aligned to _Align
+    void* allocate(size_t _Size, size_t _Align = alignof(std::max_align_t))
+    {
+        void* ptr = this->_cur;
+        size_t space = this->_end - this->_cur;
+
+        if (!ptr || !std::align(_Align, _Size, ptr, space))
+        {
+            this->_new_Block(_Size, _Align);
+
+            ptr = this->_cur;
+            space = this->_end - this->_cur;
+            std::align(_Align, _Size, ptr, space);
+        }
+
+        this->_cur = static_cast<std::byte*>(ptr) + _Size;
+        this->_bytes_used += _Size;
+        return ptr;
+    }
+
+    //Construct object of type U inside the arena
+    template<typename U, typename... Args>
+    U* create(Args&&... args)
+    {
+        return ::new (this->allocate(sizeof(U), alignof(U))) U(std::forward<Args>(args)...);
+    }
+
+    //Forget every object but keep the last (biggest) block for the next fill.
+    //Objects living in the arena must have been destroyed beforehand
+    void reset() noexcept
+    {
+        if (!this->_head)
+            return;
+
+        _free_Blocks(this->_head->prev);
+        this->_head->prev = nullptr;
+
+        this->_cur = reinterpret_cast<std::byte*>(this->_head) + sizeof(Block);
+        this->_bytes_used = 0;
+    }
+
+    //Give all the blocks back to the system.
+    //Objects living in the arena must have been destroyed beforehand
+    void release() noexcept
+    {
+        _free_Blocks(this->_head);
+
+        this->_head = nullptr;
+        this->_cur = this->_end = nullptr;
+        this->_next_Block_size = this->_init_Block_size;
+        this->_bytes_used = 0;
+    }
+
+    size_t bytes_used() const noexcept
+    {
+        return this->_bytes_used;
+    }
+};
+
+//Types that are able to clone themselves into an arena
+template<typename TypeToClone>
+concept arena_cloneable = requires(TypeToClone const& obj, Arena& arena)
+{ obj.clone(arena); };
+
+//Element policies decide how pointees of a PtrArray are created and destroyed.
+//A policy object lives inside the array and hands out a 'handle_type' that every Wrapper keeps,
+//so Wrapper can clone, adopt and destroy its pointee without knowing about the array.
+//Handles must be trivially copyable and tell whether they are the same via 'same': a pointer
+//moved between slots with different handles gets re-homed into the destination one
+
+//Default policy: every pointee is a separate heap object made by T::clone() and freed with 'delete'
+struct HeapAllocator
+{
+    using handle_type = HeapAllocator;
+
+    //Whether handles may clone from several threads at once
+    static constexpr bool concurrent_clone = true;
+
+    constexpr handle_type handle() const noexcept { return {}; }
+
+    //Called after all the elements have been destroyed
+    constexpr void reset() noexcept { }
+
+    template<typename T>
+    static constexpr T* clone(T const& obj) { return obj.clone(); }
+
+    template<typename U, typename... Args>
+    static constexpr U* make(Args&&... args) { return new U(std::forward<Args>(args)...); }
+
+    template<typename T>
+    static constexpr T* adopt(T* ptr) noexcept { return ptr; }
+
+    template<typename T>
+    static constexpr void destroy(T* ptr) noexcept { delete ptr; }
+
+    static constexpr bool same(HeapAllocator) noexcept { return true; }
+};
+
+//Policy that keeps every pointee inside an arena owned by the array.
+//Clearing or destroying the array runs the destructors and then frees the arena in bulk.
+//Pointees moved out of the array into standalone Wrappers must not outlive it
+class ArenaAllocator
+{
+public:
+    //Arena the pointee lives in, nullptr stands for a detached heap pointee
+    struct handle_type
+    {
+        Arena* arena = nullptr;
+
+        template<arena_cloneable T>
+        T* clone(T const& obj) const
+        {
+            return this->arena ? obj.clone(*this->arena) : obj.clone();
+        }
+
+        template<typename U, typename... Args>
+        U* make(Args&&... args) const
+        {
+            return this->arena
+                ? this->arena->create<U>(std::forward<Args>(args)...)
+                : new U(std::forward<Args>(args)...);
+        }
+
+        //Heap pointers given to the array are copied into the arena
+        template<arena_cloneable T>
+        T* adopt(T* ptr) const
+        {
+            if (!this->arena || !ptr)
+                return ptr;
+
+            std::unique_ptr<T> owned(ptr);
+            return owned->clone(*this->arena);
+        }
+
+        template<typename T>
+        void destroy(T* ptr) const noexcept
+        {
+            if (!this->arena) delete ptr;
+            else if (ptr) ptr->~T();
+        }
+
+        bool same(handle_type const& other) const noexcept { return this->arena == other.arena; }
+    };
+
+private:
+    //Arena is kept on the heap so the handles stay valid when the array is moved
+    std::unique_ptr<Arena> _arena;
+
+public:
+    static constexpr bool concurrent_clone = false;
+
+    //Constructors
+    explicit ArenaAllocator(size_t _Block_Size = 4096)
+        : _arena(std::make_unique<Arena>(_Block_Size))
+    { }
+
+    //Copies start with an empty arena, the array clones its elements into it
+    ArenaAllocator(ArenaAllocator const&)
+        : ArenaAllocator()
+    { }
+
+    ArenaAllocator(ArenaAllocator&&) noexcept = default;
+
+    //Assignment keeps the own arena
+    ArenaAllocator& operator=(ArenaAllocator const&) noexcept { return *this; }
+    ArenaAllocator& operator=(ArenaAllocator&&) noexcept = default;
+
+    handle_type handle() const noexcept { return { this->_arena.get() }; }
+
+    void reset() noexcept
+    {
+        if (this->_arena)
+            this->_arena->reset();
+    }
+
+    Arena* arena() const noexcept
+    {
+        return this->_arena.get();
+    }
+};
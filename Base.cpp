@@ -1,5 +1,7 @@
 #pragma once
 #include "stdafx.h"
+#include "Arena.cpp"
+#include "Serialization.cpp"
 
 class Person {
 public:
@@ -17,7 +19,7 @@ public:
         return Person(this->name + " " + other.name, this->age + other.age);
     }
 
-    static friend std::ostream& operator<<(std::ostream& is, Person& ps)
+    friend std::ostream& operator<<(std::ostream& is, Person& ps)
     {
         std::print(is, "Name: {0}; Age: {1};\n", ps.name, ps.age);
 
@@ -31,51 +33,89 @@ class Base {
 protected:
     int field;
 public:
-    explicit Base(int a) : field(a) { }
+    constexpr explicit Base(int a) : field(a) { }
     Base(Base const& other) = default;
     Base(Base&& other) = default;
     virtual void display() const = 0; // Pure virtual function
-    virtual Base* clone() const = 0;
-    int getValue() const { return field; }
+    constexpr virtual Base* clone() const = 0;
+    virtual Base* clone(Arena& arena) const = 0;
+    //Size of the dynamic type, for byte counts such as Reclaimer::pending_bytes()
+    virtual size_t size_bytes() const = 0;
+    constexpr int getValue() const { return field; }
 
     std::strong_ordering operator<=>(Base const& other) const = default;
-    bool operator==(int val) const { return this->field == val; }
+    constexpr bool operator==(int val) const { return this->field == val; }
 
     Base& operator=(Base&& other) = default;
     Base& operator=(Base const& other) = default;
 
-    static friend std::ostream& operator<<(std::ostream& out, Base const& other)
+    friend std::ostream& operator<<(std::ostream& out, Base const& other)
     {
         out << other.getValue();
 
         return out;
     }
 
-    virtual ~Base() = default; // Virtual destructor
+    constexpr virtual ~Base() = default; // Virtual destructor
 };
 
-class Derived1 : public Base {
+class Derived1 final : public Base {
 public:
     using Base::Base;
+
+    //Spelled out, GCC 12 does not define an implicit constexpr virtual destructor in time for constant evaluation
+    constexpr ~Derived1() override { }
+
     void display() const override {
         std::cout << "Derived1" << std::endl;
     }
 
-    Base* clone() const override
+    constexpr Base* clone() const override
     {
         return new Derived1(*this);
     }
+
+    Base* clone(Arena& arena) const override
+    {
+        return arena.create<Derived1>(*this);
+    }
+
+    size_t size_bytes() const override { return sizeof(Derived1); }
 };
 
-class Derived2 : public Base {
+class Derived2 final : public Base {
 public:
     using Base::Base;
+
+    constexpr ~Derived2() override { }
+
     void display() const override {
         std::cout << "Derived2" << std::endl;
     }
 
-    Base* clone() const override
+    constexpr Base* clone() const override
     {
         return new Derived2(*this);
     }
-};
\ No newline at end of file
+
+    Base* clone(Arena& arena) const override
+    {
+        return arena.create<Derived2>(*this);
+    }
+
+    size_t size_bytes() const override { return sizeof(Derived2); }
+};
+
+//Tags of the binary format (see Serialization.cpp)
+inline const bool _base_types_registered = []
+{
+    auto& registry = TypeRegistry<Base>::instance();
+    registry.add<Derived1>(1,
+        [](std::ostream& out, Derived1 const& obj) { binary_write<int32_t>(out, obj.getValue()); },
+        [](std::istream& in) { return Derived1(binary_read<int32_t>(in)); });
+    registry.add<Derived2>(2,
+        [](std::ostream& out, Derived2 const& obj) { binary_write<int32_t>(out, obj.getValue()); },
+        [](std::istream& in) { return Derived2(binary_read<int32_t>(in)); });
+
+    return true;
+}();
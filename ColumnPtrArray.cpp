@@ -0,0 +1,403 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+#include "Simd.cpp"
+
+//Keys Proj gives for the pointees, stored by position in a contiguous column.
+//A stale column is rebuilt from the array the next time it is read
+template<typename T, auto Proj>
+class ProjectionColumn
+{
+public:
+    using key_type = std::remove_cvref_t<std::invoke_result_t<decltype(Proj), T const*>>;
+
+    static_assert(std::is_arithmetic_v<key_type>, "Column keys have to be arithmetic");
+
+private:
+    //Fields
+    std::vector<key_type> _keys;
+    bool _stale = false;
+
+public:
+    //Null pointers read as key_type{}
+    static key_type project(T const* _Ptr)
+    {
+        return _Ptr ? std::invoke(Proj, _Ptr) : key_type{};
+    }
+
+    bool stale() const noexcept
+    {
+        return this->_stale;
+    }
+
+    void invalidate() noexcept
+    {
+        this->_stale = true;
+    }
+
+    //Key of every element, in order
+    template<typename Array>
+    void rebuild(Array const& _Array)
+    {
+        this->_keys.clear();
+        this->_keys.reserve(_Array.size());
+        _Array.for_each_prefetched([this](T const* elem) { this->_keys.push_back(project(elem)); });
+
+        this->_stale = false;
+    }
+
+    //Keys of the elements that were inserted at [_First, _Last), the rest of the column has to be fresh
+    template<std::random_access_iterator It>
+    void insert(size_t _Index, It _First, It _Last)
+    {
+        std::vector<key_type> keys;
+        keys.reserve(_Last - _First);
+        for (; _First != _Last; ++_First)
+            keys.push_back(project(*_First));
+
+        this->_keys.insert(this->_keys.begin() + _Index, keys.begin(), keys.end());
+        this->_stale = false;
+    }
+
+    //Drop the keys of the elements that were erased from [_First, _Last)
+    void erase(size_t _First, size_t _Last) noexcept
+    {
+        this->_keys.erase(this->_keys.begin() + _First, this->_keys.begin() + _Last);
+        this->_stale = false;
+    }
+
+    void clear() noexcept
+    {
+        this->_keys.clear();
+        this->_stale = false;
+    }
+
+    std::span<key_type const> keys() const noexcept
+    {
+        return this->_keys;
+    }
+};
+
+//Element policy that owns a ProjectionColumn and marks it stale whenever a pointee is created, adopted or destroyed,
+//so changes made through Wrappers (assignments, std algorithms moving elements around) are never missed.
+//Pointees are heap objects made by T::clone()
+template<typename T, auto Proj>
+class ColumnAllocator
+{
+public:
+    using column_type = ProjectionColumn<T, Proj>;
+
+    struct handle_type
+    {
+        //nullptr stands for a detached Wrapper that has no column
+        column_type* column = nullptr;
+
+        void touch() const noexcept
+        {
+            if (this->column)
+                this->column->invalidate();
+        }
+
+        template<typename U>
+        U* clone(U const& obj) const
+        {
+            this->touch();
+            return static_cast<U*>(obj.clone());
+        }
+
+        template<typename U, typename... Args>
+        U* make(Args&&... args) const
+        {
+            this->touch();
+            return new U(std::forward<Args>(args)...);
+        }
+
+        template<typename U>
+        U* adopt(U* ptr) const noexcept
+        {
+            this->touch();
+            return ptr;
+        }
+
+        //Called with nullptr as well when a moved-from slot is assigned, which is how elements get permuted
+        template<typename U>
+        void destroy(U* ptr) const noexcept
+        {
+            this->touch();
+            delete ptr;
+        }
+
+        bool same(handle_type const& other) const noexcept { return this->column == other.column; }
+    };
+
+private:
+    //Column is kept on the heap so the handles stay valid when the array is moved
+    std::unique_ptr<column_type> _column;
+
+public:
+    static constexpr bool concurrent_clone = false;
+
+    //Constructors
+    ColumnAllocator()
+        : _column(std::make_unique<column_type>())
+    { }
+
+    //Copies start with an empty column
+    ColumnAllocator(ColumnAllocator const&)
+        : ColumnAllocator()
+    { }
+
+    //The moved-from allocator gets a fresh column, so a moved-from array keeps tracking what it is given
+    ColumnAllocator(ColumnAllocator&& other)
+        : _column(std::exchange(other._column, std::make_unique<column_type>()))
+    { }
+
+    //Assignment keeps the own column. Moving swaps them, the other one is marked stale to be rebuilt from its elements
+    ColumnAllocator& operator=(ColumnAllocator const&) noexcept { return *this; }
+
+    ColumnAllocator& operator=(ColumnAllocator&& other) noexcept
+    {
+        std::swap(this->_column, other._column);
+        other._column->invalidate();
+        return *this;
+    }
+
+    handle_type handle() const noexcept { return { this->_column.get() }; }
+
+    void reset() noexcept
+    {
+        this->_column->clear();
+    }
+
+    column_type& column() const noexcept { return *this->_column; }
+};
+
+//PtrArray with a structure-of-arrays column of Proj (e.g. &Base::getValue), so scans over the keys
+//read one contiguous buffer with SIMD (see Simd.cpp) instead of chasing every pointer.
+//Queries return indices into the array, or npos.
+//Insertions and erasures through this class update the column in place; anything else that changes the elements
+//(Wrapper assignments, std algorithms, the projection sorts) marks it stale and it is rebuilt by the next query.
+//Pointees changed in place have to be reported with invalidate()
+template <cloneable T, auto Proj>
+class ColumnPtrArray : public PtrArray<T, ColumnAllocator<T, Proj>>
+{
+private:
+    using array_type = PtrArray<T, ColumnAllocator<T, Proj>>;
+    using column_type = typename ColumnAllocator<T, Proj>::column_type;
+
+    column_type& _column() const noexcept
+    {
+        return this->get_allocator().column();
+    }
+
+    //Run _Modify, which changes the array at the index, and bring a column that was fresh before up to date with _Update
+    template<typename Modify, typename Update>
+    void _modify(Modify _Modify, Update _Update)
+    {
+        column_type& column = this->_column();
+        bool fresh = !column.stale();
+        _Modify();
+
+        if (!fresh)
+            return;
+
+        try
+        {
+            _Update(column);
+        }
+        catch (...)
+        {
+            column.invalidate();
+            throw;
+        }
+    }
+
+public:
+    using Iterator = typename array_type::Iterator;
+    using key_type = typename column_type::key_type;
+
+    static constexpr size_t npos = size_t(-1);
+
+    //Constructors
+    using array_type::array_type;
+
+    //Modifiers
+    template <typename... Args>
+    void emplace(Iterator position, Args&&... elems)
+    {
+        size_t index = position - this->begin();
+        this->_modify([&] { array_type::emplace(position, std::forward<Args>(elems)...); },
+            [&](column_type& column) { column.insert(index, this->begin() + index, this->begin() + index + sizeof...(elems)); });
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... elems)
+    {
+        this->emplace(this->end(), std::forward<Args>(elems)...);
+    }
+
+    template <typename... Args>
+    void emplace_front(Args&&... elems)
+    {
+        this->emplace(this->begin(), std::forward<Args>(elems)...);
+    }
+
+    template <std::derived_from<T> U, typename... Args>
+    void emplace_new(Iterator position, Args&&... args)
+    {
+        size_t index = position - this->begin();
+        this->_modify([&] { array_type::template emplace_new<U>(position, std::forward<Args>(args)...); },
+            [&](column_type& column) { column.insert(index, this->begin() + index, this->begin() + index + 1); });
+    }
+
+    template <std::derived_from<T> U, typename... Args>
+    void emplace_back_new(Args&&... args)
+    {
+        this->emplace_new<U>(this->end(), std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void push_back(U&& obj)
+    {
+        this->emplace(this->end(), std::forward<U>(obj));
+    }
+
+    template<typename U>
+    void push_front(U&& obj)
+    {
+        this->emplace(this->begin(), std::forward<U>(obj));
+    }
+
+    template<std::ranges::input_range R>
+        requires std::ranges::forward_range<R> || std::ranges::sized_range<R>
+    Iterator insert_range(Iterator position, R&& range)
+    {
+        size_t index = position - this->begin();
+        size_t count = std::ranges::distance(range);
+        this->_modify([&] { array_type::insert_range(position, std::forward<R>(range)); },
+            [&](column_type& column) { column.insert(index, this->begin() + index, this->begin() + index + count); });
+
+        return this->begin() + index;
+    }
+
+    template<std::ranges::input_range R>
+    void append_range(R&& range)
+    {
+        this->insert_range(this->end(), std::forward<R>(range));
+    }
+
+    //Erase elements at [_First, _Last)
+    void erase(Iterator _First, Iterator _Last)
+    {
+        if (this->empty() || _First < this->begin() || _Last > this->end() || _First >= _Last)
+            return;
+
+        size_t first = _First - this->begin();
+        size_t last = _Last - this->begin();
+        this->_modify([&] { array_type::erase(_First, _Last); }, [&](column_type& column) { column.erase(first, last); });
+    }
+
+    void erase(Iterator position)
+    {
+        this->erase(position, position + 1);
+    }
+
+    void pop_front()
+    {
+        this->erase(this->begin());
+    }
+
+    void pop_back()
+    {
+        this->erase(this->end() - 1);
+    }
+
+    //PtrArray permutes these by swapping the raw pointers, which the handles never see
+
+    template<typename Pred>
+    Iterator remove_if(Pred pred)
+    {
+        this->invalidate();
+        return array_type::remove_if(std::move(pred));
+    }
+
+    template<typename P, typename Comp = std::ranges::less>
+    void sort_by(P proj, Comp comp = {})
+    {
+        this->invalidate();
+        array_type::sort_by(std::move(proj), std::move(comp));
+    }
+
+    template<typename P, typename Comp = std::ranges::less>
+    void stable_sort_by(P proj, Comp comp = {})
+    {
+        this->invalidate();
+        array_type::stable_sort_by(std::move(proj), std::move(comp));
+    }
+
+    template<typename P, typename Comp = std::ranges::less>
+    void nth_element_by(Iterator nth, P proj, Comp comp = {})
+    {
+        this->invalidate();
+        array_type::nth_element_by(nth, std::move(proj), std::move(comp));
+    }
+
+    //Mark the column stale, e.g. after pointees were changed in place
+    void invalidate() noexcept
+    {
+        this->_column().invalidate();
+    }
+
+    //Column queries, 'key op _Key' is what is counted or searched for
+
+    //Keys of the elements in order
+    std::span<key_type const> column() const
+    {
+        column_type& column = this->_column();
+        if (column.stale())
+            column.rebuild(*this);
+
+        return column.keys();
+    }
+
+    size_t count_if(KeyCompare _Op, key_type _Key) const
+    {
+        return simd_count(this->column(), _Op, _Key);
+    }
+
+    size_t count(key_type _Key) const
+    {
+        return this->count_if(KeyCompare::equal, _Key);
+    }
+
+    size_t find_if(KeyCompare _Op, key_type _Key) const
+    {
+        auto keys = this->column();
+        size_t index = simd_find(keys, _Op, _Key);
+        return index == keys.size() ? npos : index;
+    }
+
+    size_t find(key_type _Key) const
+    {
+        return this->find_if(KeyCompare::equal, _Key);
+    }
+
+    //Index of the first element with the smallest key
+    size_t min() const
+    {
+        auto keys = this->column();
+        return keys.empty() ? npos : simd_min(keys);
+    }
+
+    //Index of the first element with the biggest key
+    size_t max() const
+    {
+        auto keys = this->column();
+        return keys.empty() ? npos : simd_max(keys);
+    }
+
+    simd_sum_t<key_type> sum() const
+    {
+        return simd_sum(this->column());
+    }
+};
@@ -0,0 +1,274 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+//Append-only array of owned pointers that many threads may push to while others read.
+//Slots live in buckets of growing power-of-two sizes that are never moved, so elements keep their addresses.
+//push_back is lock-free: an index is reserved with one atomic increment and the slot is published through
+//an atomic size that only covers fully written slots, so readers may index [0, size()) at any time without locks.
+//Ownership follows PtrArray: rvalue pointers are adopted, lvalue ones are cloned.
+//Everything except push/emplace, reserve and the accessors requires that no other thread uses the array
+template <cloneable T>
+class ConcurrentPtrArray
+{
+private:
+    struct Slot
+    {
+        T* data = nullptr;
+        std::atomic<bool> ready = false;
+    };
+
+    //Bucket b holds 2^(b + _first_Bits) slots
+    static constexpr size_t _first_Bits = 5;
+    static constexpr size_t _bucket_Count = 64 - _first_Bits;
+
+    //Fields
+    std::atomic<Slot*> _buckets[_bucket_Count] = {};
+    std::atomic<size_t> _reserved = 0;
+    std::atomic<size_t> _committed = 0;
+
+    //Private methods
+
+    static size_t _bucket_Size(size_t _Bucket) noexcept
+    {
+        return size_t(1) << (_Bucket + _first_Bits);
+    }
+
+    //Bucket and offset of the element at _Index
+    static std::pair<size_t, size_t> _locate(size_t _Index) noexcept
+    {
+        size_t pos = _Index + _bucket_Size(0);
+        size_t bucket = std::bit_width(pos) - 1 - _first_Bits;
+
+        return { bucket, pos - _bucket_Size(bucket) };
+    }
+
+    //Allocate the bucket if nobody has done it yet, the loser of the race frees its copy
+    Slot* _get_Bucket(size_t _Bucket)
+    {
+        Slot* bucket = this->_buckets[_Bucket].load(std::memory_order_acquire);
+        if (bucket)
+            return bucket;
+
+        Slot* fresh = new Slot[_bucket_Size(_Bucket)]();
+        if (this->_buckets[_Bucket].compare_exchange_strong(bucket, fresh, std::memory_order_acq_rel))
+            return fresh;
+
+        delete[] fresh;
+        return bucket;
+    }
+
+    Slot& _slot(size_t _Index) const noexcept
+    {
+        auto [bucket, offset] = _locate(_Index);
+        return this->_buckets[bucket].load(std::memory_order_acquire)[offset];
+    }
+
+    //Whether the slot at _Index has been written, its bucket may not even exist yet
+    bool _is_Ready(size_t _Index) const noexcept
+    {
+        auto [bucket, offset] = _locate(_Index);
+        Slot* slots = this->_buckets[bucket].load(std::memory_order_acquire);
+
+        return slots && slots[offset].ready.load();
+    }
+
+    //Make the pointer that goes into a slot, before any index is reserved so that a throwing clone leaves no hole
+    template<typename U>
+    static T* _make_Element(U&& _Elem)
+    {
+        using elem_type = std::remove_cvref_t<U>;
+        constexpr bool owned = !std::is_lvalue_reference_v<U&&>;
+
+        if constexpr (_is_unique_ptr<elem_type>)
+        {
+            if constexpr (owned) return static_cast<T*>(_Elem.release());
+            else return _Elem ? HeapAllocator::clone(static_cast<T const&>(*_Elem)) : nullptr;
+        }
+        else if constexpr (owned && std::is_convertible_v<elem_type, T*>)
+            return static_cast<T*>(_Elem);
+        else
+        {
+            T const* ptr = _Elem;
+            return ptr ? HeapAllocator::clone(*ptr) : nullptr;
+        }
+    }
+
+    //Reserve an index, fill its slot and move the size over every slot that is ready.
+    //Whichever appender finds the next slot ready advances the size, so a slow appender delays readers
+    //but never blocks other appenders. A bucket that cannot be allocated terminates, the slot could never be published
+    size_t _publish(T* _Ptr) noexcept
+    {
+        size_t index = this->_reserved.fetch_add(1, std::memory_order_relaxed);
+
+        auto [bucket, offset] = _locate(index);
+        Slot& slot = this->_get_Bucket(bucket)[offset];
+        slot.data = _Ptr;
+        slot.ready.store(true);
+
+        size_t committed = this->_committed.load();
+        while (committed < this->_reserved.load(std::memory_order_relaxed) && this->_is_Ready(committed))
+        {
+            //On failure 'committed' is reloaded and the loop carries on from there
+            if (this->_committed.compare_exchange_weak(committed, committed + 1))
+                ++committed;
+        }
+
+        return index;
+    }
+
+public:
+    //Random-access iterator over the elements that were published when it was created
+    class Iterator
+    {
+    private:
+        ConcurrentPtrArray const* m_arr;
+        size_t m_ind;
+
+    public:
+        //Aliases for std library algorithms
+        using iterator_concept = std::random_access_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T*;
+        using reference = T*;
+
+        //Constructors
+        Iterator() : m_arr(nullptr), m_ind(0) { }
+
+        Iterator(ConcurrentPtrArray const* m_arr, size_t m_ind) : m_arr(m_arr), m_ind(m_ind) { }
+
+        //Accessors
+        reference operator*() const { return (*m_arr)[m_ind]; }
+        reference operator->() const { return **this; }
+        reference operator[](difference_type ind) const { return *(*this + ind); }
+
+        //Arithmetic
+        Iterator& operator++() { ++m_ind; return *this; }
+        Iterator& operator--() { --m_ind; return *this; }
+
+        Iterator operator++(int) { auto temp = *this; ++m_ind; return temp; }
+        Iterator operator--(int) { auto temp = *this; --m_ind; return temp; }
+
+        Iterator operator+(difference_type n) const { return Iterator(m_arr, m_ind + n); }
+        Iterator operator-(difference_type n) const { return Iterator(m_arr, m_ind - n); }
+
+        Iterator& operator+=(difference_type n) { m_ind += n; return *this; }
+        Iterator& operator-=(difference_type n) { m_ind -= n; return *this; }
+
+        friend Iterator operator+(difference_type n, Iterator other) { return other + n; }
+        difference_type operator-(Iterator const& rhs) const { return difference_type(m_ind) - difference_type(rhs.m_ind); }
+
+        //Comparison
+        bool operator==(Iterator const& rhs) const { return m_ind == rhs.m_ind; }
+        std::strong_ordering operator<=>(Iterator const& rhs) const { return m_ind <=> rhs.m_ind; }
+    };
+
+    //Constructors
+    ConcurrentPtrArray() = default;
+
+    //Clones the elements published so far
+    ConcurrentPtrArray(ConcurrentPtrArray const& other)
+    {
+        for (T const* elem : other)
+            this->push_back(elem);
+    }
+
+    //Deep copy of a PtrArray
+    template<typename Alloc, typename Growth, typename Stats>
+    explicit ConcurrentPtrArray(PtrArray<T, Alloc, Growth, Stats> const& other)
+    {
+        this->reserve(other.size());
+        for (T const* elem : other)
+            this->push_back(elem);
+    }
+
+    ConcurrentPtrArray& operator=(ConcurrentPtrArray const&) = delete;
+
+    ~ConcurrentPtrArray()
+    {
+        this->clear();
+    }
+
+    //Modifiers
+
+    //Append the element and return its index
+    template<typename U>
+    size_t push_back(U&& obj)
+    {
+        return this->_publish(_make_Element(std::forward<U>(obj)));
+    }
+
+    template<typename... Args>
+    void emplace_back(Args&&... elems)
+    {
+        (this->push_back(std::forward<Args>(elems)), ...);
+    }
+
+    template<std::derived_from<T> U, typename... Args>
+    size_t emplace_back_new(Args&&... args)
+    {
+        return this->_publish(HeapAllocator::make<U>(std::forward<Args>(args)...));
+    }
+
+    //Allocate the buckets for _Count elements up front, so the appends do not allocate
+    void reserve(size_t _Count)
+    {
+        if (_Count)
+            for (size_t bucket = 0, last = _locate(_Count - 1).first; bucket <= last; ++bucket)
+                this->_get_Bucket(bucket);
+    }
+
+    //Destroy the elements and free the buckets, must not run concurrently with anything else
+    void clear() noexcept
+    {
+        size_t size = this->_reserved.load();
+        for (size_t i = 0; i < size; ++i)
+            HeapAllocator::destroy(this->_slot(i).data);
+
+        for (auto& bucket : this->_buckets)
+            delete[] bucket.exchange(nullptr);
+
+        this->_reserved = 0;
+        this->_committed = 0;
+    }
+
+    //Capacity
+
+    //Number of elements readers can see, grows while the array is appended to
+    size_t size() const noexcept
+    {
+        return this->_committed.load(std::memory_order_acquire);
+    }
+
+    bool empty() const noexcept
+    {
+        return !this->size();
+    }
+
+    //Accessors
+
+    T const& at(const size_t index) const noexcept(false)
+    {
+        if (index >= this->size())
+            throw std::out_of_range("Index of the array is out of the range");
+
+        return *this->_slot(index).data;
+    }
+
+    //Index has to be below a size() seen before
+    T* operator[](const size_t index) const noexcept
+    {
+        return this->_slot(index).data;
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(this, 0);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(this, this->size());
+    }
+};
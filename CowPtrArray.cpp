@@ -0,0 +1,256 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+//Copy-on-write array of pointers for cheap snapshots.
+//Copying the array is O(1): copies share one block of reference-counted slots.
+//The first modification of a shared block gives the array its own block (O(n) reference count bumps),
+//and an element is cloned only the first time it is reached through a non-const accessor.
+//Read through a const object (or cbegin/cend) to keep the data shared
+template <cloneable T>
+class CowPtrArray
+{
+public:
+    template<bool IsConst> class BasicIterator;
+    using Iterator = BasicIterator<false>;
+    using ConstIterator = BasicIterator<true>;
+
+    //Aliases
+    using slot_type = std::shared_ptr<T>;
+    using block_type = std::vector<slot_type>;
+
+private:
+    //Fields
+    std::shared_ptr<block_type> _block;
+
+    //Private methods
+
+    //Make sure the block exists and is not shared with other arrays
+    block_type& _detach_Block()
+    {
+        if (!this->_block)
+            this->_block = std::make_shared<block_type>();
+        else if (this->_block.use_count() > 1)
+            this->_block = std::make_shared<block_type>(*this->_block);
+
+        return *this->_block;
+    }
+
+    //Clone the pointee if somebody else still sees it
+    static T* _detach_Element(slot_type& _Slot)
+    {
+        if (_Slot && _Slot.use_count() > 1)
+            _Slot.reset(_Slot->clone());
+
+        return _Slot.get();
+    }
+
+    //Ownership rules of PtrArray: rvalue pointers are adopted, lvalue ones are cloned
+    template<typename U>
+    static slot_type _make_Slot(U&& _Elem)
+    {
+        if constexpr (std::is_rvalue_reference_v<U&&> && std::is_pointer_v<std::remove_cvref_t<U>>)
+            return slot_type(_Elem);
+        else
+            return slot_type(_Elem ? _Elem->clone() : nullptr);
+    }
+
+    slot_type const* _data() const noexcept
+    {
+        return this->_block ? this->_block->data() : nullptr;
+    }
+
+public:
+    //Random-access iterator, mutable one clones shared elements as it dereferences them
+    template<bool IsConst>
+    class BasicIterator
+    {
+    private:
+        using slot_pointer = std::conditional_t<IsConst, slot_type const*, slot_type*>;
+        slot_pointer m_ptr;
+
+    public:
+        //Aliases for std library algorithms
+        using iterator_concept = std::random_access_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::conditional_t<IsConst, T const*, T*>;
+        using reference = value_type;
+
+        //Constructors
+        BasicIterator() : m_ptr(nullptr) { }
+
+        explicit BasicIterator(slot_pointer m_ptr) : m_ptr(m_ptr) { }
+
+        //Accessors
+        reference operator*() const
+        {
+            if constexpr (IsConst) return m_ptr->get();
+            else return _detach_Element(*m_ptr);
+        }
+
+        reference operator->() const { return **this; }
+        reference operator[](difference_type ind) const { return *(*this + ind); }
+
+        //Arithmetic
+        BasicIterator& operator++() { ++m_ptr; return *this; }
+        BasicIterator& operator--() { --m_ptr; return *this; }
+
+        BasicIterator operator++(int) { auto temp = *this; ++m_ptr; return temp; }
+        BasicIterator operator--(int) { auto temp = *this; --m_ptr; return temp; }
+
+        BasicIterator operator+(difference_type n) const { return BasicIterator(m_ptr + n); }
+        BasicIterator operator-(difference_type n) const { return BasicIterator(m_ptr - n); }
+
+        BasicIterator& operator+=(difference_type n) { m_ptr += n; return *this; }
+        BasicIterator& operator-=(difference_type n) { m_ptr -= n; return *this; }
+
+        friend BasicIterator operator+(difference_type n, BasicIterator other) { return other + n; }
+        difference_type operator-(BasicIterator const& rhs) const { return m_ptr - rhs.m_ptr; }
+
+        //Comparison
+        bool operator==(BasicIterator const& rhs) const = default;
+        std::strong_ordering operator<=>(BasicIterator const& rhs) const = default;
+    };
+
+    //Constructors
+    CowPtrArray() = default;
+    CowPtrArray(CowPtrArray const& other) = default;
+    CowPtrArray(CowPtrArray&& other) noexcept = default;
+
+    //Deep copy of a PtrArray, the result can then be shared for free
+    template<typename Alloc, typename Growth, typename Stats>
+    explicit CowPtrArray(PtrArray<T, Alloc, Growth, Stats> const& other)
+        : _block(std::make_shared<block_type>())
+    {
+        this->_block->reserve(other.size());
+        for (T const* elem : other)
+            this->_block->push_back(_make_Slot(elem));
+    }
+
+    //Copy and assignment operators
+    CowPtrArray& operator=(CowPtrArray const& other) = default;
+    CowPtrArray& operator=(CowPtrArray&& other) noexcept = default;
+
+    //Modifiers
+    template <typename... Args>
+    void emplace(ConstIterator position, Args&&... elems)
+    {
+        size_t index = position - this->cbegin();
+        auto& block = this->_detach_Block();
+
+        block.insert(block.begin() + index, { _make_Slot(std::forward<Args>(elems))... });
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... elems)
+    {
+        auto& block = this->_detach_Block();
+        (block.push_back(_make_Slot(std::forward<Args>(elems))), ...);
+    }
+
+    template<typename U>
+    void push_back(U&& obj)
+    {
+        this->emplace_back(std::forward<U>(obj));
+    }
+
+    //Erase elements at [_First, _Last)
+    void erase(ConstIterator _First, ConstIterator _Last)
+    {
+        if (this->empty() || _First < this->cbegin() || _Last > this->cend() || _First >= _Last)
+            return;
+
+        size_t first = _First - this->cbegin();
+        size_t last = _Last - this->cbegin();
+
+        auto& block = this->_detach_Block();
+        block.erase(block.begin() + first, block.begin() + last);
+    }
+
+    void erase(ConstIterator position)
+    {
+        this->erase(position, position + 1);
+    }
+
+    //Only drops the own reference, other copies keep their data
+    void clear() noexcept
+    {
+        this->_block.reset();
+    }
+
+    //Capacity
+    size_t size() const noexcept
+    {
+        return this->_block ? this->_block->size() : 0;
+    }
+
+    bool empty() const noexcept
+    {
+        return !this->size();
+    }
+
+    //Whether the slot block is currently shared with another copy
+    bool is_shared() const noexcept
+    {
+        return this->_block && this->_block.use_count() > 1;
+    }
+
+    //Accessors
+    T const& at(const size_t index) const noexcept(false)
+    {
+        if (index >= this->size())
+            throw std::out_of_range("Index of the array is out of the range");
+
+        return *(*this->_block)[index];
+    }
+
+    T const* operator[](const size_t index) const noexcept
+    {
+        if (this->empty())
+            return nullptr;
+
+        return (*this->_block)[index < this->size() ? index : 0].get();
+    }
+
+    //Mutable access clones the element if it is shared
+    T* operator[](const size_t index)
+    {
+        if (this->empty())
+            return nullptr;
+
+        auto& block = this->_detach_Block();
+        return _detach_Element(block[index < block.size() ? index : 0]);
+    }
+
+    Iterator begin()
+    {
+        return Iterator(this->_detach_Block().data());
+    }
+
+    Iterator end()
+    {
+        auto& block = this->_detach_Block();
+        return Iterator(block.data() + block.size());
+    }
+
+    ConstIterator begin() const
+    {
+        return ConstIterator(this->_data());
+    }
+
+    ConstIterator end() const
+    {
+        return ConstIterator(this->_data() + this->size());
+    }
+
+    ConstIterator cbegin() const
+    {
+        return this->begin();
+    }
+
+    ConstIterator cend() const
+    {
+        return this->end();
+    }
+};
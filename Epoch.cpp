@@ -0,0 +1,237 @@
+#pragma once
+#include "stdafx.h"
+
+//Epoch-based reclamation for structures read without locks.
+//Readers pin the current epoch with an EpochGuard (one store when entering and one when leaving),
+//writers retire what they have unlinked and advance the epoch; a retired object is destroyed
+//once every reader that was pinned when it got retired has left.
+//Process-wide: use EpochDomain::instance()
+class EpochDomain
+{
+private:
+    friend class EpochGuard;
+
+    //Per-thread reader state, 0 stands for a thread that is not reading
+    struct Record
+    {
+        std::atomic<uint64_t> epoch = 0;
+        std::atomic<bool> used = true;
+        size_t nesting = 0;
+    };
+
+    //Type-erased retired object
+    struct Retired
+    {
+        void* ptr;
+        void (*destroy)(void*);
+        uint64_t epoch;
+    };
+
+    //Gives the record of an exiting thread back to the domain
+    struct RecordOwner
+    {
+        Record* record = nullptr;
+        ~RecordOwner() { if (this->record) this->record->used.store(false, std::memory_order_release); }
+    };
+
+    //Fields
+    std::atomic<uint64_t> _epoch = 1;
+
+    std::mutex _records_mutex;
+    std::deque<Record> _records;
+
+    std::mutex _retired_mutex;
+    std::vector<Retired> _retired;
+
+    //Private methods
+    EpochDomain() = default;
+
+    static RecordOwner& _local_Owner() noexcept
+    {
+        static thread_local RecordOwner owner;
+        return owner;
+    }
+
+    //Record of the calling thread, a record left by a finished thread is reused
+    Record& _local_Record()
+    {
+        RecordOwner& owner = _local_Owner();
+        if (owner.record)
+            return *owner.record;
+
+        std::lock_guard lock(this->_records_mutex);
+        for (auto& record : this->_records)
+        {
+            bool expected = false;
+            if (record.used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return *(owner.record = &record);
+        }
+
+        return *(owner.record = &this->_records.emplace_back());
+    }
+
+    //Objects retired before this epoch are not seen by anybody, the pin of _Skip is not taken into account
+    uint64_t _safe_Epoch(Record const* _Skip = nullptr)
+    {
+        uint64_t safe = this->_epoch.load();
+
+        std::lock_guard lock(this->_records_mutex);
+        for (auto const& record : this->_records)
+            if (uint64_t epoch = record.epoch.load(); &record != _Skip && epoch && epoch < safe)
+                safe = epoch;
+
+        return safe;
+    }
+
+    //Start a new epoch and wait until every reader pinned before it has left
+    void _wait_Readers(Record const* _Skip = nullptr)
+    {
+        uint64_t target = this->advance();
+        while (this->_safe_Epoch(_Skip) < target)
+            std::this_thread::yield();
+    }
+
+public:
+    EpochDomain(EpochDomain const&) = delete;
+    EpochDomain& operator=(EpochDomain const&) = delete;
+
+    ~EpochDomain()
+    {
+        for (auto& retired : this->_retired)
+            retired.destroy(retired.ptr);
+    }
+
+    static EpochDomain& instance()
+    {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    //Take over an object that readers may still see, it is deleted by a later reclaim().
+    //Called from destructors, so it never throws: an object that can not be queued is deleted as soon as
+    //the readers of other threads have left. Waiting for its own guard would never end, so the calling thread
+    //must not retire an object while it holds a guard (or a snapshot) that can still reach it
+    template<typename T>
+    void retire(T* _Ptr) noexcept
+    {
+        if (!_Ptr)
+            return;
+
+        try
+        {
+            std::lock_guard lock(this->_retired_mutex);
+            this->_retired.push_back({ _Ptr, [](void* ptr) { delete static_cast<T*>(ptr); }, this->_epoch.load() });
+            return;
+        }
+        catch (...) { }
+
+        this->_wait_Readers(_local_Owner().record);
+        delete _Ptr;
+    }
+
+    //Start a new epoch, called after new data has been published
+    uint64_t advance() noexcept
+    {
+        return this->_epoch.fetch_add(1) + 1;
+    }
+
+    //Destroy the retired objects no reader can see anymore, returns their number
+    size_t reclaim()
+    {
+        uint64_t safe = this->_safe_Epoch();
+
+        std::vector<Retired> batch;
+        {
+            std::lock_guard lock(this->_retired_mutex);
+            auto pending = std::ranges::partition(this->_retired, [safe](Retired const& r) { return r.epoch >= safe; });
+            batch.assign(pending.begin(), pending.end());
+            this->_retired.erase(pending.begin(), pending.end());
+        }
+
+        for (auto& retired : batch)
+            retired.destroy(retired.ptr);
+
+        return batch.size();
+    }
+
+    //Wait for the readers that are inside a guard now and destroy everything retired so far.
+    //Must not be called while the calling thread holds a guard
+    void synchronize()
+    {
+        this->_wait_Readers();
+        this->reclaim();
+    }
+
+    //Number of retired objects that are not destroyed yet
+    size_t pending()
+    {
+        std::lock_guard lock(this->_retired_mutex);
+        return this->_retired.size();
+    }
+};
+
+//Pins the current epoch of the domain for the lifetime of the guard, guards of one thread may nest
+class EpochGuard
+{
+private:
+    EpochDomain::Record* _record;
+
+public:
+    //Constructors
+    explicit EpochGuard(EpochDomain& _Domain = EpochDomain::instance())
+        : _record(&_Domain._local_Record())
+    {
+        if (this->_record->nesting++ == 0)
+            this->_record->epoch.store(_Domain._epoch.load());
+    }
+
+    EpochGuard(EpochGuard&& other) noexcept
+        : _record(std::exchange(other._record, nullptr))
+    { }
+
+    EpochGuard(EpochGuard const&) = delete;
+    EpochGuard& operator=(EpochGuard const&) = delete;
+    EpochGuard& operator=(EpochGuard&&) = delete;
+
+    ~EpochGuard()
+    {
+        if (this->_record && --this->_record->nesting == 0)
+            this->_record->epoch.store(0, std::memory_order_release);
+    }
+};
+
+//Element policy that retires destroyed pointees into the epoch domain, so readers that still see them stay safe.
+//Pointees are ordinary heap objects, so pointers moved between arrays never get re-homed
+class EpochAllocator
+{
+public:
+    struct handle_type
+    {
+        //nullptr deletes right away, as detached Wrappers do
+        EpochDomain* domain = nullptr;
+
+        template<typename T>
+        T* clone(T const& obj) const { return obj.clone(); }
+
+        template<typename U, typename... Args>
+        U* make(Args&&... args) const { return new U(std::forward<Args>(args)...); }
+
+        template<typename T>
+        T* adopt(T* ptr) const noexcept { return ptr; }
+
+        template<typename T>
+        void destroy(T* ptr) const noexcept
+        {
+            if (this->domain) this->domain->retire(ptr);
+            else delete ptr;
+        }
+
+        bool same(handle_type const&) const noexcept { return true; }
+    };
+
+    static constexpr bool concurrent_clone = true;
+
+    handle_type handle() const noexcept { return { &EpochDomain::instance() }; }
+
+    void reset() noexcept { }
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include "stdafx.h"
+
+//Growth policies decide the new capacity of a PtrArray that has to grow.
+//They are called as policy(current capacity, required capacity) and must return at least the required one
+//The array clamps the result to its max_size(), so policies do not have to guard against overflow
+
+//Multiply the required capacity by Num / Den (doubling by default)
+template<size_t Num = 2, size_t Den = 1>
+struct GeometricGrowth
+{
+    static_assert(Num > Den, "Geometric growth factor has to be greater than 1");
+
+    size_t operator()(size_t, size_t _Required) const noexcept
+    {
+        return std::max(_Required, (_Required + 1) * Num / Den);
+    }
+};
+
+//Grow by whole chunks of Chunk slots
+template<size_t Chunk>
+struct ChunkGrowth
+{
+    static_assert(Chunk > 0, "Chunk has to hold at least one slot");
+
+    size_t operator()(size_t, size_t _Required) const noexcept
+    {
+        return (_Required / Chunk + 1) * Chunk;
+    }
+};
+
+//Delegate the decision to a user function
+struct CallbackGrowth
+{
+    std::function<size_t(size_t, size_t)> callback;
+
+    size_t operator()(size_t _Current, size_t _Required) const
+    {
+        return std::max(_Required, this->callback(_Current, _Required));
+    }
+};
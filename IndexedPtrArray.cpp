@@ -0,0 +1,260 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+//Hash index of pointees by the key Proj gives for them.
+//Entries refer to the objects, not to positions, so shifting elements around never touches the index
+template<typename T, auto Proj>
+class ProjectionIndex
+{
+public:
+    using key_type = std::remove_cvref_t<std::invoke_result_t<decltype(Proj), T const*>>;
+
+private:
+    using bucket_type = std::unordered_set<T*>;
+
+    //Fields
+    //Objects of a key are a set of their own, so unindexing one is O(1) however many share the key
+    std::unordered_map<key_type, bucket_type> _by_key;
+    std::unordered_map<T const*, key_type> _keys;
+
+public:
+    void insert(T* _Ptr)
+    {
+        if (!_Ptr)
+            return;
+
+        key_type key = std::invoke(Proj, static_cast<T const*>(_Ptr));
+        auto bucket = this->_by_key.try_emplace(key).first;
+        try
+        {
+            bucket->second.insert(_Ptr);
+            this->_keys.emplace(_Ptr, std::move(key));
+        }
+        catch (...)
+        {
+            bucket->second.erase(_Ptr);
+            if (bucket->second.empty())
+                this->_by_key.erase(bucket);
+            throw;
+        }
+    }
+
+    //Remove the object under the key it was indexed with, which may differ from its current one
+    void erase(T const* _Ptr) noexcept
+    {
+        auto key = this->_keys.find(_Ptr);
+        if (key == this->_keys.end())
+            return;
+
+        auto bucket = this->_by_key.find(key->second);
+        bucket->second.erase(const_cast<T*>(_Ptr));
+        if (bucket->second.empty())
+            this->_by_key.erase(bucket);
+
+        this->_keys.erase(key);
+    }
+
+    void clear() noexcept
+    {
+        this->_by_key.clear();
+        this->_keys.clear();
+    }
+
+    //Some object with the key or nullptr
+    T* find(key_type const& _Key) const
+    {
+        auto it = this->_by_key.find(_Key);
+        return it == this->_by_key.end() ? nullptr : *it->second.begin();
+    }
+
+    //All objects with the key, in no particular order
+    std::ranges::subrange<typename bucket_type::const_iterator> equal_range(key_type const& _Key) const
+    {
+        auto it = this->_by_key.find(_Key);
+        if (it == this->_by_key.end())
+            return {};
+
+        return { it->second.begin(), it->second.end() };
+    }
+
+    size_t count(key_type const& _Key) const
+    {
+        auto it = this->_by_key.find(_Key);
+        return it == this->_by_key.end() ? 0 : it->second.size();
+    }
+
+    size_t size() const noexcept
+    {
+        return this->_keys.size();
+    }
+};
+
+//Element policy that keeps a ProjectionIndex of the pointees: whatever creates a pointee in the array
+//(emplace, push_back, insert_range, assignment through Wrapper) indexes it, and destroying it unindexes it.
+//Pointees are heap objects made by T::clone()
+template<typename T, auto Proj>
+class IndexedAllocator
+{
+public:
+    using index_type = ProjectionIndex<T, Proj>;
+
+    struct handle_type
+    {
+        //nullptr stands for a detached Wrapper that indexes nothing
+        index_type* index = nullptr;
+
+        template<typename U>
+        U* clone(U const& obj) const
+        {
+            return this->adopt(static_cast<U*>(obj.clone()));
+        }
+
+        template<typename U, typename... Args>
+        U* make(Args&&... args) const
+        {
+            return this->adopt(new U(std::forward<Args>(args)...));
+        }
+
+        template<typename U>
+        U* adopt(U* ptr) const
+        {
+            if (this->index)
+            {
+                std::unique_ptr<U> owned(ptr);
+                this->index->insert(ptr);
+                owned.release();
+            }
+
+            return ptr;
+        }
+
+        template<typename U>
+        void destroy(U* ptr) const noexcept
+        {
+            if (this->index)
+                this->index->erase(ptr);
+
+            delete ptr;
+        }
+
+        //Pointers moved into another array get re-homed, so both indexes see the move
+        bool same(handle_type const& other) const noexcept { return this->index == other.index; }
+    };
+
+private:
+    //Index is kept on the heap so the handles stay valid when the array is moved
+    std::unique_ptr<index_type> _index;
+
+public:
+    static constexpr bool concurrent_clone = false;
+
+    //Constructors
+    IndexedAllocator()
+        : _index(std::make_unique<index_type>())
+    { }
+
+    //Copies start with an empty index, the array indexes its clones into it
+    IndexedAllocator(IndexedAllocator const&)
+        : IndexedAllocator()
+    { }
+
+    //The moved-from allocator gets a fresh index, so a moved-from array keeps indexing what it is given
+    IndexedAllocator(IndexedAllocator&& other)
+        : _index(std::exchange(other._index, std::make_unique<index_type>()))
+    { }
+
+    //Assignment keeps the own index. Moving swaps them: the array empties its own before it is assigned,
+    //so the other one is left with an empty index
+    IndexedAllocator& operator=(IndexedAllocator const&) noexcept { return *this; }
+
+    IndexedAllocator& operator=(IndexedAllocator&& other) noexcept
+    {
+        std::swap(this->_index, other._index);
+        return *this;
+    }
+
+    handle_type handle() const noexcept { return { this->_index.get() }; }
+
+    void reset() noexcept
+    {
+        this->_index->clear();
+    }
+
+    index_type& index() const noexcept { return *this->_index; }
+};
+
+//PtrArray with a hash index over Proj (e.g. &Base::getValue), kept up to date by every modification.
+//find() and equal_range() take O(1) on average instead of a scan.
+//Pointees changed in place have to be reindexed by hand
+template <cloneable T, auto Proj>
+class IndexedPtrArray : public PtrArray<T, IndexedAllocator<T, Proj>>
+{
+private:
+    using array_type = PtrArray<T, IndexedAllocator<T, Proj>>;
+    using index_type = typename IndexedAllocator<T, Proj>::index_type;
+
+    index_type& _index() const noexcept
+    {
+        return this->get_allocator().index();
+    }
+
+public:
+    using key_type = typename index_type::key_type;
+
+    //Constructors
+    using array_type::array_type;
+
+    //Lookup
+    T* find(key_type const& _Key) const
+    {
+        return this->_index().find(_Key);
+    }
+
+    auto equal_range(key_type const& _Key) const
+    {
+        return this->_index().equal_range(_Key);
+    }
+
+    size_t count(key_type const& _Key) const
+    {
+        return this->_index().count(_Key);
+    }
+
+    bool contains(key_type const& _Key) const
+    {
+        return this->find(_Key) != nullptr;
+    }
+
+    //Rebuild hooks
+
+    //Move an element that was changed in place under its new key
+    void reindex(T* _Elem)
+    {
+        this->_index().erase(_Elem);
+        this->_index().insert(_Elem);
+    }
+
+    //Rebuild the whole index
+    void reindex()
+    {
+        this->_index().clear();
+        for (T* elem : *this)
+            this->_index().insert(elem);
+    }
+
+    //Modifiers
+
+    //The index is dropped in one go before the elements are destroyed, instead of unindexing them one by one
+    void clear()
+    {
+        this->_index().clear();
+        array_type::clear();
+    }
+
+    void release()
+    {
+        this->_index().clear();
+        array_type::release();
+    }
+};
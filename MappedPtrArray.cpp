@@ -0,0 +1,632 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Read-write mapping of a whole file that can be resized
+class MappedFile
+{
+private:
+    //Fields
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+    char* _data = nullptr;
+    size_t _size = 0;
+
+    //Private methods
+
+    [[noreturn]] static void _throw_Error(char const* _What)
+    {
+#ifdef _WIN32
+        throw std::system_error(int(GetLastError()), std::system_category(), _What);
+#else
+        throw std::system_error(errno, std::generic_category(), _What);
+#endif
+    }
+
+    //Map the first _Size bytes of the file, nothing for an empty one
+    char* _map(size_t _Size)
+    {
+        if (!_Size)
+            return nullptr;
+
+#ifdef _WIN32
+        this->_mapping = CreateFileMappingW(this->_file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+        if (!this->_mapping)
+            _throw_Error("Failed to map the file");
+
+        char* data = static_cast<char*>(MapViewOfFile(this->_mapping, FILE_MAP_ALL_ACCESS, 0, 0, _Size));
+        if (!data)
+            _throw_Error("Failed to map the file");
+
+        return data;
+#else
+        void* data = mmap(nullptr, _Size, PROT_READ | PROT_WRITE, MAP_SHARED, this->_fd, 0);
+        if (data == MAP_FAILED)
+            _throw_Error("Failed to map the file");
+
+        return static_cast<char*>(data);
+#endif
+    }
+
+    //Set the size of the file on the disk
+    bool _set_Size(size_t _Size) noexcept
+    {
+#ifdef _WIN32
+        LARGE_INTEGER size;
+        size.QuadPart = LONGLONG(_Size);
+        return SetFilePointerEx(this->_file, size, nullptr, FILE_BEGIN) && SetEndOfFile(this->_file);
+#else
+        return ftruncate(this->_fd, off_t(_Size)) == 0;
+#endif
+    }
+
+    void _unmap() noexcept
+    {
+#ifdef _WIN32
+        if (this->_data)
+            UnmapViewOfFile(this->_data);
+        if (this->_mapping)
+            CloseHandle(this->_mapping);
+
+        this->_mapping = nullptr;
+#else
+        if (this->_data)
+            munmap(this->_data, this->_size);
+#endif
+        this->_data = nullptr;
+    }
+
+    void _close() noexcept
+    {
+#ifdef _WIN32
+        if (this->_file != INVALID_HANDLE_VALUE)
+            CloseHandle(this->_file);
+
+        this->_file = INVALID_HANDLE_VALUE;
+#else
+        if (this->_fd >= 0)
+            ::close(this->_fd);
+
+        this->_fd = -1;
+#endif
+    }
+
+public:
+    //Constructors
+
+    //Open the file for reading and writing, it is created if it does not exist
+    explicit MappedFile(std::filesystem::path const& _Path)
+    {
+#ifdef _WIN32
+        this->_file = CreateFileW(_Path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (this->_file == INVALID_HANDLE_VALUE)
+            _throw_Error("Failed to open the file");
+#else
+        this->_fd = ::open(_Path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (this->_fd < 0)
+            _throw_Error("Failed to open the file");
+#endif
+
+        //The destructor does not run for a constructor that throws, so the file is closed here
+        try
+        {
+#ifdef _WIN32
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(this->_file, &size))
+                _throw_Error("Failed to get the size of the file");
+
+            this->_size = size_t(size.QuadPart);
+#else
+            struct stat info;
+            if (fstat(this->_fd, &info) != 0)
+                _throw_Error("Failed to get the size of the file");
+
+            this->_size = size_t(info.st_size);
+#endif
+            this->_data = this->_map(this->_size);
+        }
+        catch (...)
+        {
+            this->_unmap();
+            this->_close();
+            throw;
+        }
+    }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    ~MappedFile()
+    {
+        this->_unmap();
+        this->_close();
+    }
+
+    //Change the size of the file, the data may move to another address.
+    //If it fails the file keeps its size and stays mapped where it was
+    void resize(size_t _new_Size)
+    {
+#ifdef _WIN32
+        //A mapped file cannot be shrunk: the old view goes first and is mapped again if anything fails
+        this->_unmap();
+        try
+        {
+            if (!this->_set_Size(_new_Size))
+                _throw_Error("Failed to resize the file");
+
+            this->_data = this->_map(_new_Size);
+        }
+        catch (...)
+        {
+            this->_unmap();
+            this->_set_Size(this->_size);
+            this->_data = this->_map(this->_size);
+            throw;
+        }
+#else
+        //The new mapping is made before the old one is dropped, a file is grown before and shrunk after mapping it
+        bool grow = _new_Size > this->_size;
+        if (grow && !this->_set_Size(_new_Size))
+            _throw_Error("Failed to resize the file");
+
+        char* data;
+        try
+        {
+            data = this->_map(_new_Size);
+        }
+        catch (...)
+        {
+            if (grow)
+                this->_set_Size(this->_size);
+            throw;
+        }
+
+        if (!grow && !this->_set_Size(_new_Size))
+        {
+            int error = errno;
+            if (data)
+                munmap(data, _new_Size);
+            throw std::system_error(error, std::generic_category(), "Failed to resize the file");
+        }
+
+        this->_unmap();
+        this->_data = data;
+#endif
+        this->_size = _new_Size;
+    }
+
+    //Write the changed pages back to the file
+    void flush()
+    {
+        if (!this->_data)
+            return;
+
+#ifdef _WIN32
+        if (!FlushViewOfFile(this->_data, this->_size) || !FlushFileBuffers(this->_file))
+            _throw_Error("Failed to flush the file");
+#else
+        if (msync(this->_data, this->_size, MS_SYNC) != 0)
+            _throw_Error("Failed to flush the file");
+#endif
+    }
+
+    char* data() const noexcept
+    {
+        return this->_data;
+    }
+
+    size_t size() const noexcept
+    {
+        return this->_size;
+    }
+};
+
+//Array of polymorphic objects kept in a memory-mapped file, so a restart opens it in O(1) instead of rebuilding it.
+//The file holds a table of slots with offsets from the start of the file (0 for nullptr) and a record per object
+//with its type tag and payload in the format of TypeRegistry, so no vtable pointer is ever stored.
+//An element is turned into an object when it is accessed. Only the cache_limit most recently accessed objects are kept,
+//so memory stays bounded however big the file is: a pointer given by operator[] or an Iterator is valid until
+//cache_limit other elements have been accessed or its slot changes. Accessed objects are read-only copies:
+//store a changed object with set(). Not thread-safe
+template <cloneable T>
+class MappedPtrArray
+{
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t length;
+        uint64_t capacity;
+        uint64_t table;
+        uint64_t end;
+    };
+
+    //Object record is its byte size followed by the tag and the payload
+    using record_size = uint64_t;
+
+    static constexpr uint32_t _magic = 0x4d525450;
+    static constexpr uint32_t _version = 1;
+    static constexpr size_t _init_capacity = 16;
+    static constexpr size_t _init_file_size = 64 << 10;
+
+    //Streambuf that reads a record right from the mapping
+    struct _Record_buffer : std::streambuf
+    {
+        _Record_buffer(char const* _Data, size_t _Size)
+        {
+            char* data = const_cast<char*>(_Data);
+            this->setg(data, data, data + _Size);
+        }
+    };
+
+    //Cached object and its place in the use order
+    struct _Cached
+    {
+        std::unique_ptr<T> obj;
+        std::list<size_t>::iterator use;
+    };
+
+    //Fields
+    MappedFile _file;
+    TypeRegistry<T> const* _registry;
+    size_t _cache_limit;
+    mutable std::unordered_map<size_t, _Cached> _cache;
+    //Indices of the cached objects, most recently used first
+    mutable std::list<size_t> _uses;
+
+    //Private methods
+
+    Header& _header() const noexcept
+    {
+        return *reinterpret_cast<Header*>(this->_file.data());
+    }
+
+    uint64_t* _table() const noexcept
+    {
+        return reinterpret_cast<uint64_t*>(this->_file.data() + this->_header().table);
+    }
+
+    //Empty array: header, slot table right after it and no records
+    void _initialize()
+    {
+        if (this->_file.size() < _init_file_size)
+            this->_file.resize(_init_file_size);
+
+        Header& header = this->_header();
+        header = { _magic, _version, 0, _init_capacity, sizeof(Header), sizeof(Header) + _init_capacity * sizeof(uint64_t) };
+    }
+
+    //Take _Size bytes (8-aligned) at the end of the used part, the file grows geometrically
+    uint64_t _reserve_Bytes(size_t _Size)
+    {
+        uint64_t offset = (this->_header().end + 7) & ~uint64_t(7);
+        if (offset + _Size > this->_file.size())
+            this->_file.resize(std::max<size_t>(offset + _Size, this->_file.size() << 1));
+
+        this->_header().end = offset + _Size;
+        return offset;
+    }
+
+    //Move the slot table into a twice bigger place at the end of the file, the old one is left unused
+    void _grow_Table()
+    {
+        size_t capacity = this->_header().capacity << 1;
+        uint64_t table = this->_reserve_Bytes(capacity * sizeof(uint64_t));
+
+        std::memcpy(this->_file.data() + table, this->_table(), this->_header().length * sizeof(uint64_t));
+        this->_header().table = table;
+        this->_header().capacity = capacity;
+    }
+
+    //Write the record of the object, 0 for nullptr
+    uint64_t _write_Record(T const* _Obj)
+    {
+        if (!_Obj)
+            return 0;
+
+        std::ostringstream stream;
+        this->_registry->write(stream, _Obj);
+        std::string bytes = std::move(stream).str();
+
+        uint64_t offset = this->_reserve_Bytes(sizeof(record_size) + bytes.size());
+        record_size size = bytes.size();
+        std::memcpy(this->_file.data() + offset, &size, sizeof(size));
+        std::memcpy(this->_file.data() + offset + sizeof(size), bytes.data(), bytes.size());
+
+        return offset;
+    }
+
+    //Check that the header describes a table and records that lie inside the file
+    void _validate_Header() const
+    {
+        Header const& header = this->_header();
+        bool valid = header.length <= header.capacity
+            && header.table >= sizeof(Header) && header.table % alignof(uint64_t) == 0
+            && header.end <= this->_file.size()
+            && header.table <= header.end
+            && header.capacity <= (header.end - header.table) / sizeof(uint64_t);
+
+        if (!valid)
+            throw std::runtime_error("Header of the mapped array is corrupted");
+    }
+
+    //Restore the object from its record through the registry.
+    //Offsets and sizes come from the file, so the record has to lie within the used part of it
+    T* _read_Record(uint64_t _Offset) const
+    {
+        uint64_t end = this->_header().end;
+        if (_Offset < sizeof(Header) || _Offset > end || end - _Offset < sizeof(record_size))
+            throw std::runtime_error("Slot of the mapped array is corrupted");
+
+        record_size size;
+        std::memcpy(&size, this->_file.data() + _Offset, sizeof(size));
+        if (size > end - _Offset - sizeof(record_size))
+            throw std::runtime_error("Record of the mapped array is corrupted");
+
+        _Record_buffer buffer(this->_file.data() + _Offset + sizeof(size), size);
+        std::istream stream(&buffer);
+
+        return this->_registry->read(stream);
+    }
+
+    //Cached object of the slot or nullptr, it becomes the most recently used one
+    T* _cache_Find(size_t _Index) const
+    {
+        auto it = this->_cache.find(_Index);
+        if (it == this->_cache.end())
+            return nullptr;
+
+        this->_uses.splice(this->_uses.begin(), this->_uses, it->second.use);
+        return it->second.obj.get();
+    }
+
+    //Cache the object of the slot, the least recently used ones over the limit are dropped
+    T* _cache_Put(size_t _Index, std::unique_ptr<T> _Obj) const
+    {
+        this->_cache_Erase(_Index);
+
+        this->_uses.push_front(_Index);
+        try
+        {
+            this->_cache.emplace(_Index, _Cached{ std::move(_Obj), this->_uses.begin() });
+        }
+        catch (...)
+        {
+            this->_uses.pop_front();
+            throw;
+        }
+
+        while (this->_cache.size() > this->_cache_limit)
+            this->_cache_Erase(this->_uses.back());
+
+        return this->_cache.at(_Index).obj.get();
+    }
+
+    void _cache_Erase(size_t _Index) const noexcept
+    {
+        auto it = this->_cache.find(_Index);
+        if (it == this->_cache.end())
+            return;
+
+        this->_uses.erase(it->second.use);
+        this->_cache.erase(it);
+    }
+
+    //Ownership rules of PtrArray: rvalue pointers are taken over (and become the cached object), lvalue ones are copied
+    template<typename U>
+    void _store(size_t _Index, U&& _Obj)
+    {
+        std::unique_ptr<T> taken;
+        if constexpr (!std::is_lvalue_reference_v<U&&> && std::is_convertible_v<std::remove_cvref_t<U>, T*>)
+            taken.reset(_Obj);
+
+        uint64_t offset = this->_write_Record(static_cast<T const*>(_Obj));
+        this->_table()[_Index] = offset;
+
+        if (taken) this->_cache_Put(_Index, std::move(taken));
+        else this->_cache_Erase(_Index);
+    }
+
+public:
+    //Random-access iterator, stays valid while the file grows
+    class Iterator
+    {
+    private:
+        MappedPtrArray const* m_arr;
+        size_t m_ind;
+
+    public:
+        //Aliases for std library algorithms
+        using iterator_concept = std::random_access_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T const*;
+        using reference = T const*;
+
+        //Constructors
+        Iterator() : m_arr(nullptr), m_ind(0) { }
+
+        Iterator(MappedPtrArray const* m_arr, size_t m_ind) : m_arr(m_arr), m_ind(m_ind) { }
+
+        //Accessors
+        reference operator*() const { return (*m_arr)[m_ind]; }
+        reference operator->() const { return **this; }
+        reference operator[](difference_type ind) const { return *(*this + ind); }
+
+        //Arithmetic
+        Iterator& operator++() { ++m_ind; return *this; }
+        Iterator& operator--() { --m_ind; return *this; }
+
+        Iterator operator++(int) { auto temp = *this; ++m_ind; return temp; }
+        Iterator operator--(int) { auto temp = *this; --m_ind; return temp; }
+
+        Iterator operator+(difference_type n) const { return Iterator(m_arr, m_ind + n); }
+        Iterator operator-(difference_type n) const { return Iterator(m_arr, m_ind - n); }
+
+        Iterator& operator+=(difference_type n) { m_ind += n; return *this; }
+        Iterator& operator-=(difference_type n) { m_ind -= n; return *this; }
+
+        friend Iterator operator+(difference_type n, Iterator other) { return other + n; }
+        difference_type operator-(Iterator const& rhs) const { return difference_type(m_ind) - difference_type(rhs.m_ind); }
+
+        //Comparison
+        bool operator==(Iterator const& rhs) const { return m_ind == rhs.m_ind; }
+        std::strong_ordering operator<=>(Iterator const& rhs) const { return m_ind <=> rhs.m_ind; }
+    };
+
+    //Constructors
+
+    static constexpr size_t default_cache_limit = 1024;
+
+    //Open the array stored in the file or start a new one if the file is empty.
+    //At most _Cache_Limit (at least 1) accessed objects are kept in memory
+    explicit MappedPtrArray(std::filesystem::path const& _Path, TypeRegistry<T> const& _Registry = TypeRegistry<T>::instance(),
+        size_t _Cache_Limit = default_cache_limit)
+        : _file(_Path), _registry(&_Registry), _cache_limit(std::max<size_t>(_Cache_Limit, 1))
+    {
+        if (!this->_file.size())
+            this->_initialize();
+        else if (this->_file.size() < sizeof(Header) || this->_header().magic != _magic || this->_header().version != _version)
+            throw std::runtime_error("File does not hold a mapped array");
+        else
+            this->_validate_Header();
+    }
+
+    MappedPtrArray(MappedPtrArray const&) = delete;
+    MappedPtrArray& operator=(MappedPtrArray const&) = delete;
+
+    //Modifiers
+    template<typename U>
+    void push_back(U&& obj)
+    {
+        if (this->_header().length == this->_header().capacity)
+            this->_grow_Table();
+
+        size_t index = this->_header().length;
+        this->_store(index, std::forward<U>(obj));
+        ++this->_header().length;
+    }
+
+    template<typename... Args>
+    void emplace_back(Args&&... elems)
+    {
+        (this->push_back(std::forward<Args>(elems)), ...);
+    }
+
+    //Replace the element, the old record is left unused
+    template<typename U>
+    void set(size_t index, U&& obj)
+    {
+        if (index >= this->size())
+            throw std::out_of_range("Index of the array is out of the range");
+
+        this->_store(index, std::forward<U>(obj));
+    }
+
+    void pop_back()
+    {
+        if (this->empty())
+            return;
+
+        this->_cache_Erase(--this->_header().length);
+    }
+
+    //Drop the elements and give the space of the records back
+    void clear()
+    {
+        this->_cache.clear();
+        this->_uses.clear();
+        this->_initialize();
+    }
+
+    //Write the changes to the disk
+    void flush()
+    {
+        this->_file.flush();
+    }
+
+    //Capacity
+    size_t size() const noexcept
+    {
+        return this->_header().length;
+    }
+
+    bool empty() const noexcept
+    {
+        return !this->size();
+    }
+
+    //Bytes of the file in use
+    size_t bytes_used() const noexcept
+    {
+        return this->_header().end;
+    }
+
+    //Number of objects held in memory, never more than cache_limit()
+    size_t cached() const noexcept
+    {
+        return this->_cache.size();
+    }
+
+    size_t cache_limit() const noexcept
+    {
+        return this->_cache_limit;
+    }
+
+    //Accessors
+    T const& at(const size_t index) const noexcept(false)
+    {
+        if (index >= this->size())
+            throw std::out_of_range("Index of the array is out of the range");
+
+        T const* elem = (*this)[index];
+        if (!elem)
+            throw std::out_of_range("Element of the array is nullptr");
+
+        return *elem;
+    }
+
+    //Out of range indices give the first element, or nullptr for an empty array, as in PtrArray
+    T const* operator[](const size_t index) const
+    {
+        if (index >= this->size())
+            return this->empty() ? nullptr : (*this)[0];
+
+        uint64_t offset = this->_table()[index];
+        if (!offset)
+            return nullptr;
+
+        if (T* cached = this->_cache_Find(index))
+            return cached;
+
+        return this->_cache_Put(index, std::unique_ptr<T>(this->_read_Record(offset)));
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(this, 0);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(this, this->size());
+    }
+};
@@ -0,0 +1,174 @@
+#pragma once
+#include "stdafx.h"
+#include "ThreadPool.cpp"
+
+//Parallel algorithms over random-access ranges such as PtrArray.
+//The range is split into contiguous chunks that run as tasks of a work-stealing pool;
+//callbacks get the elements the same way std algorithms do, so lambdas taking 'T const*' work as usual
+
+//Smallest number of elements worth a task of its own
+inline constexpr size_t parallel_grain = 1024;
+
+//Split [0, _Size) into chunks and run _Body(first, last) for each of them, returns when all are done
+template<typename Body>
+void _parallel_Chunks(size_t _Size, ThreadPool& _Pool, Body&& _Body)
+{
+    size_t chunks = std::min((_Size + parallel_grain - 1) / parallel_grain, _Pool.size() * 4);
+    if (chunks <= 1)
+    {
+        if (_Size)
+            _Body(size_t(0), _Size);
+
+        return;
+    }
+
+    TaskGroup group(_Pool);
+    size_t step = (_Size + chunks - 1) / chunks;
+    for (size_t first = 0; first < _Size; first += step)
+        group.run([&_Body, first, last = std::min(first + step, _Size)] { _Body(first, last); });
+
+    group.wait();
+}
+
+//Sort chunks in parallel, then merge neighbouring runs in parallel rounds
+template<std::random_access_iterator It, typename Comp>
+void _parallel_Merge_sort(It _First, size_t _Size, Comp& _Comp, ThreadPool& _Pool)
+{
+    size_t chunks = std::min((_Size + parallel_grain - 1) / parallel_grain, _Pool.size() * 4);
+    if (chunks <= 1)
+    {
+        std::sort(_First, _First + _Size, _Comp);
+        return;
+    }
+
+    size_t run = (_Size + chunks - 1) / chunks;
+    {
+        TaskGroup group(_Pool);
+        for (size_t first = 0; first < _Size; first += run)
+            group.run([&, first] { std::sort(_First + first, _First + std::min(first + run, _Size), _Comp); });
+
+        group.wait();
+    }
+
+    for (; run < _Size; run <<= 1)
+    {
+        TaskGroup group(_Pool);
+        for (size_t first = 0; first + run < _Size; first += run << 1)
+        {
+            group.run([&, first]
+            {
+                std::inplace_merge(_First + first, _First + first + run,
+                    _First + std::min(first + (run << 1), _Size), _Comp);
+            });
+        }
+
+        group.wait();
+    }
+}
+
+template<std::ranges::random_access_range R, typename Fn>
+void parallel_for_each(R&& range, Fn fn, ThreadPool& pool = ThreadPool::instance())
+{
+    auto first = std::ranges::begin(range);
+    _parallel_Chunks(std::ranges::distance(range), pool, [&](size_t begin, size_t end)
+    {
+        std::for_each(first + begin, first + end, fn);
+    });
+}
+
+//Reduce must be associative: the chunks are reduced independently and then combined in order
+template<std::ranges::random_access_range R, typename Type, typename Reduce, typename Transform>
+Type parallel_transform_reduce(R&& range, Type init, Reduce reduce, Transform transform, ThreadPool& pool = ThreadPool::instance())
+{
+    auto first = std::ranges::begin(range);
+    size_t size = std::ranges::distance(range);
+
+    std::mutex mutex;
+    std::vector<std::pair<size_t, Type>> partial;
+    _parallel_Chunks(size, pool, [&](size_t begin, size_t end)
+    {
+        Type acc = std::invoke(transform, first[begin]);
+        for (size_t i = begin + 1; i < end; ++i)
+            acc = std::invoke(reduce, std::move(acc), std::invoke(transform, first[i]));
+
+        std::lock_guard lock(mutex);
+        partial.emplace_back(begin, std::move(acc));
+    });
+
+    std::ranges::sort(partial, std::ranges::less(), &std::pair<size_t, Type>::first);
+    for (auto& [_, value] : partial)
+        init = std::invoke(reduce, std::move(init), std::move(value));
+
+    return init;
+}
+
+//With a projection every key is computed once (in parallel), the (key, index) pairs are sorted
+//and the elements are moved to their places through a buffer
+template<std::ranges::random_access_range R, typename Comp = std::ranges::less, typename Proj = std::identity>
+void parallel_sort(R&& range, Comp comp = {}, Proj proj = {}, ThreadPool& pool = ThreadPool::instance())
+{
+    auto first = std::ranges::begin(range);
+    size_t size = std::ranges::distance(range);
+
+    if constexpr (std::is_same_v<Proj, std::identity>)
+        _parallel_Merge_sort(first, size, comp, pool);
+    else
+    {
+        using value_type = std::ranges::range_value_t<R>;
+        using key_type = std::remove_cvref_t<std::invoke_result_t<Proj&, std::ranges::range_reference_t<R>>>;
+
+        std::vector<std::pair<key_type, size_t>> keys(size);
+        _parallel_Chunks(size, pool, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                keys[i] = { std::invoke(proj, first[i]), i };
+        });
+
+        auto key_comp = [&comp](auto const& a, auto const& b) { return std::invoke(comp, a.first, b.first); };
+        _parallel_Merge_sort(keys.begin(), size, key_comp, pool);
+
+        //Move-construct into raw storage so the elements keep the handles of their slots
+        std::allocator<value_type> allocator;
+        value_type* buffer = allocator.allocate(size);
+        _parallel_Chunks(size, pool, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                std::construct_at(buffer + i, std::move(first[keys[i].second]));
+        });
+
+        _parallel_Chunks(size, pool, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                first[i] = std::move(buffer[i]);
+                std::destroy_at(buffer + i);
+            }
+        });
+
+        allocator.deallocate(buffer, size);
+    }
+}
+
+//Chunks past the first match found so far stop early
+template<std::ranges::random_access_range R, typename Pred>
+std::ranges::iterator_t<R> parallel_find_if(R&& range, Pred pred, ThreadPool& pool = ThreadPool::instance())
+{
+    auto first = std::ranges::begin(range);
+    size_t size = std::ranges::distance(range);
+
+    std::atomic<size_t> found = size;
+    _parallel_Chunks(size, pool, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end && i < found.load(std::memory_order_relaxed); ++i)
+        {
+            if (std::invoke(pred, first[i]))
+            {
+                size_t current = found.load(std::memory_order_relaxed);
+                while (i < current && !found.compare_exchange_weak(current, i, std::memory_order_relaxed));
+                return;
+            }
+        }
+    });
+
+    return first + found.load();
+}
@@ -0,0 +1,264 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+//Polymorphic array that groups elements by their dynamic type.
+//Objects of every concrete type are stored by value in their own contiguous segment,
+//so passes over the array walk memory linearly and hit one vtable at a time.
+//Iteration goes segment by segment, so the order of insertion is kept only among objects of the same type
+template <cloneable T>
+class PolyPtrArray
+{
+private:
+    //Type-erased storage of one concrete type
+    struct Segment
+    {
+        virtual ~Segment() = default;
+
+        virtual std::unique_ptr<Segment> copy() const = 0;
+        virtual size_t size() const noexcept = 0;
+        virtual T* at(size_t _Index) noexcept = 0;
+        virtual void push_copy(T const& _Obj) = 0;
+        virtual void push_move(T&& _Obj) = 0;
+        virtual void erase(size_t _Index) = 0;
+        virtual void clear() noexcept = 0;
+    };
+
+    template<std::derived_from<T> U>
+    struct TypedSegment : Segment
+    {
+        std::vector<U> elems;
+
+        std::unique_ptr<Segment> copy() const override { return std::make_unique<TypedSegment>(*this); }
+        size_t size() const noexcept override { return this->elems.size(); }
+        T* at(size_t _Index) noexcept override { return &this->elems[_Index]; }
+        void push_copy(T const& _Obj) override { this->elems.push_back(static_cast<U const&>(_Obj)); }
+        void push_move(T&& _Obj) override { this->elems.push_back(static_cast<U&&>(_Obj)); }
+        void erase(size_t _Index) override { this->elems.erase(this->elems.begin() + _Index); }
+        void clear() noexcept override { this->elems.clear(); }
+    };
+
+    //Fields
+    std::vector<std::type_index> _types;
+    std::vector<std::unique_ptr<Segment>> _segments;
+
+    //Private methods
+
+    //Index of the segment for the dynamic type or npos
+    size_t _find_Segment(std::type_index _Type) const noexcept
+    {
+        auto it = std::ranges::find(this->_types, _Type);
+        return it == this->_types.end() ? npos : it - this->_types.begin();
+    }
+
+    template<std::derived_from<T> U>
+    TypedSegment<U>& _get_Segment()
+    {
+        size_t index = this->_find_Segment(typeid(U));
+        if (index == npos)
+        {
+            this->_types.emplace_back(typeid(U));
+            this->_segments.push_back(std::make_unique<TypedSegment<U>>());
+            index = this->_segments.size() - 1;
+        }
+
+        return static_cast<TypedSegment<U>&>(*this->_segments[index]);
+    }
+
+    Segment& _get_Segment(T const& _Obj)
+    {
+        size_t index = this->_find_Segment(typeid(_Obj));
+        if (index == npos)
+            throw std::invalid_argument("Dynamic type of the object is not registered in the array");
+
+        return *this->_segments[index];
+    }
+
+public:
+    static constexpr size_t npos = size_t(-1);
+
+    //Forward iterator that walks the segments one after another
+    class Iterator
+    {
+    private:
+        friend class PolyPtrArray;
+
+        std::unique_ptr<Segment> const* m_seg;
+        std::unique_ptr<Segment> const* m_last;
+        size_t m_ind;
+
+        //Step over exhausted and empty segments
+        void _skip_Empty()
+        {
+            while (m_seg != m_last && m_ind >= (*m_seg)->size())
+                ++m_seg, m_ind = 0;
+        }
+
+    public:
+        //Aliases for std library algorithms
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T*;
+        using reference = T*;
+
+        //Constructors
+        Iterator() : m_seg(nullptr), m_last(nullptr), m_ind(0) { }
+
+        Iterator(std::unique_ptr<Segment> const* m_seg, std::unique_ptr<Segment> const* m_last)
+            : m_seg(m_seg), m_last(m_last), m_ind(0)
+        { this->_skip_Empty(); }
+
+        //Accessors
+        reference operator*() const { return (*m_seg)->at(m_ind); }
+        reference operator->() const { return **this; }
+
+        //Arithmetic
+        Iterator& operator++() { ++m_ind; this->_skip_Empty(); return *this; }
+        Iterator operator++(int) { auto temp = *this; ++*this; return temp; }
+
+        //Comparison
+        bool operator==(Iterator const& rhs) const
+        {
+            return m_seg == rhs.m_seg && (m_seg == m_last || m_ind == rhs.m_ind);
+        }
+    };
+
+    //Constructors
+    PolyPtrArray() = default;
+
+    PolyPtrArray(PolyPtrArray const& other)
+        : _types(other._types)
+    {
+        this->_segments.reserve(other._segments.size());
+        for (auto const& segment : other._segments)
+            this->_segments.push_back(segment->copy());
+    }
+
+    PolyPtrArray(PolyPtrArray&& other) noexcept = default;
+
+    //Copy and assignment operators
+    PolyPtrArray& operator=(PolyPtrArray const& other)
+    {
+        if (this != &other)
+            *this = PolyPtrArray(other);
+
+        return *this;
+    }
+
+    PolyPtrArray& operator=(PolyPtrArray&& other) noexcept = default;
+
+    //Create the segment for U up front so objects of this type can be inserted through a T reference
+    template<std::derived_from<T> U>
+    void register_type()
+    {
+        this->_get_Segment<U>();
+    }
+
+    //Modifiers
+    template<std::derived_from<T> U, typename... Args>
+    U& emplace(Args&&... args)
+    {
+        return this->_get_Segment<U>().elems.emplace_back(std::forward<Args>(args)...);
+    }
+
+    //Copy the object into the segment of its dynamic type, which has to be registered
+    void insert(T const& obj)
+    {
+        this->_get_Segment(obj).push_copy(obj);
+    }
+
+    //Ownership rules of PtrArray: rvalue pointers are consumed, lvalue ones are copied
+    template<typename U>
+    void push_back(U&& obj)
+    {
+        if constexpr (std::is_rvalue_reference_v<U&&> && std::is_pointer_v<std::remove_cvref_t<U>>)
+        {
+            std::unique_ptr<T> owned(obj);
+            this->_get_Segment(*owned).push_move(std::move(*owned));
+        }
+        else this->insert(*obj);
+    }
+
+    template<typename... Args>
+    void emplace_back(Args&&... elems)
+    {
+        (this->push_back(std::forward<Args>(elems)), ...);
+    }
+
+    //Erase the element, the following elements of the same segment shift to the left
+    void erase(Iterator position)
+    {
+        (*position.m_seg)->erase(position.m_ind);
+    }
+
+    //Keeps the segments, so registered types stay registered
+    void clear() noexcept
+    {
+        for (auto& segment : this->_segments)
+            segment->clear();
+    }
+
+    //Capacity
+    size_t size() const noexcept
+    {
+        size_t size = 0;
+        for (auto const& segment : this->_segments)
+            size += segment->size();
+
+        return size;
+    }
+
+    bool empty() const noexcept
+    {
+        return !this->size();
+    }
+
+    template<std::derived_from<T> U>
+    size_t size() const noexcept
+    {
+        size_t index = this->_find_Segment(typeid(U));
+        return index == npos ? 0 : this->_segments[index]->size();
+    }
+
+    //Per-type access
+
+    //Contiguous objects of exactly type U
+    template<std::derived_from<T> U>
+    std::span<U> segment() const noexcept
+    {
+        size_t index = this->_find_Segment(typeid(U));
+        if (index == npos)
+            return {};
+
+        return static_cast<TypedSegment<U>&>(*this->_segments[index]).elems;
+    }
+
+    //Call fn on every element. Segments of the listed types are walked with their static type,
+    //so calls made by fn on them can be inlined; the rest is visited through T&
+    template<std::derived_from<T>... Us, typename Fn>
+    void for_each(Fn fn) const
+    {
+        for (size_t i = 0; i < this->_segments.size(); ++i)
+        {
+            bool visited = ((this->_types[i] == typeid(Us)
+                ? (std::ranges::for_each(static_cast<TypedSegment<Us>&>(*this->_segments[i]).elems, fn), true)
+                : false) || ...);
+
+            if (!visited)
+                for (size_t j = 0, size = this->_segments[i]->size(); j < size; ++j)
+                    fn(*this->_segments[i]->at(j));
+        }
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(this->_segments.data(), this->_segments.data() + this->_segments.size());
+    }
+
+    Iterator end() const
+    {
+        auto last = this->_segments.data() + this->_segments.size();
+        return Iterator(last, last);
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include "stdafx.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+//Software prefetching of pointees, hides the latency of chasing pointers during linear passes
+
+//Distance is picked from the size of the pass
+inline constexpr size_t prefetch_auto = size_t(-1);
+
+//Hint the CPU to bring the first cache line of the object in for reading
+inline void prefetch_read(void const* _Ptr) noexcept
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<char const*>(_Ptr), _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(_Ptr, 0, 3);
+#else
+    (void)_Ptr;
+#endif
+}
+
+//Passes that fit into L2 gain nothing from prefetching, bigger ones keep a few cache misses in flight
+inline size_t prefetch_distance(size_t _Count, size_t _Element_Size) noexcept
+{
+    constexpr size_t l2_size = 256 << 10;
+    constexpr size_t misses_in_flight = 16;
+
+    return _Count * _Element_Size <= l2_size ? 0 : misses_in_flight;
+}
+
+//Forward iterator over a range of pointer-like elements that prefetches the pointee some elements ahead
+template<std::random_access_iterator It>
+class PrefetchIterator
+{
+private:
+    It m_it;
+    It m_last;
+    std::ptrdiff_t m_dist;
+
+    void _prefetch_Ahead() const noexcept
+    {
+        if (m_dist && m_last - m_it > m_dist)
+            if (auto const* ptr = std::to_address(*(m_it + m_dist)))
+                prefetch_read(ptr);
+    }
+
+public:
+    //Aliases for std library algorithms
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::iter_difference_t<It>;
+    using value_type = std::iter_value_t<It>;
+    using reference = std::iter_reference_t<It>;
+
+    //Constructors
+    PrefetchIterator() : m_it(), m_last(), m_dist(0) { }
+
+    PrefetchIterator(It m_it, It m_last, std::ptrdiff_t m_dist)
+        : m_it(m_it), m_last(m_last), m_dist(m_dist)
+    {
+        //Warm up the first window
+        for (std::ptrdiff_t i = 0; i < m_dist && i < m_last - m_it; ++i)
+            if (auto const* ptr = std::to_address(m_it[i]))
+                prefetch_read(ptr);
+    }
+
+    //Accessors
+    reference operator*() const { return *m_it; }
+
+    It base() const { return m_it; }
+
+    //Arithmetic
+    PrefetchIterator& operator++() { this->_prefetch_Ahead(); ++m_it; return *this; }
+    PrefetchIterator operator++(int) { auto temp = *this; ++*this; return temp; }
+
+    //Comparison
+    bool operator==(PrefetchIterator const& rhs) const { return m_it == rhs.m_it; }
+};
+
+//View of the range that prefetches pointees _Distance elements ahead while it is walked
+template<std::ranges::random_access_range R>
+auto prefetched(R&& range, size_t _Distance = prefetch_auto)
+{
+    using iterator = PrefetchIterator<std::ranges::iterator_t<R>>;
+
+    auto first = std::ranges::begin(range);
+    auto last = std::ranges::end(range);
+    if (_Distance == prefetch_auto)
+        _Distance = prefetch_distance(last - first, sizeof(std::ranges::range_value_t<R>) + 64);
+
+    return std::ranges::subrange(iterator(first, last, _Distance), iterator(last, last, _Distance));
+}
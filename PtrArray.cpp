@@ -1,12 +1,33 @@
 #pragma once
 #include "stdafx.h"
+#include "Arena.cpp"
+#include "Reclaimer.cpp"
+#include "GrowthPolicy.cpp"
+#include "Stats.cpp"
+#include "Prefetch.cpp"
+#include "Serialization.cpp"
+#include "ParallelAlgorithms.cpp"
 
 template<typename TypeToClone>
 concept cloneable = requires(TypeToClone obj)
 { obj.clone(); };
 
+template<typename>
+inline constexpr bool _is_unique_ptr = false;
+
+template<typename U, typename D>
+inline constexpr bool _is_unique_ptr<std::unique_ptr<U, D>> = true;
+
+//Wrapper of a PtrArray instantiation other than Self's (different T, Alloc, Growth or Stats)
+template<typename W, typename Self>
+concept _foreign_Wrapper = !std::is_same_v<W, Self> && requires { typename W::container_type; }
+    && std::is_same_v<W, typename W::container_type::Wrapper>;
+
 //Non-movable array that stores pointers
-template <cloneable T>
+//Alloc is the element policy (see Arena.cpp) that creates and destroys the pointees,
+//Growth picks the new capacity when the array is full (see GrowthPolicy.cpp),
+//Stats counts what the array does, nothing by default (see Stats.cpp)
+template <cloneable T, typename Alloc = HeapAllocator, typename Growth = GeometricGrowth<>, typename Stats = NoStats>
 class PtrArray
 {
 public:
@@ -17,40 +38,120 @@ public:
     using value_type = Wrapper;
     using pointer = value_type*;
     using reference = value_type&;
+    using allocator_type = Alloc;
+    using growth_policy = Growth;
+    using stats_policy = Stats;
+    using handle_type = typename Stats::template handle_type<typename Alloc::handle_type>;
 
 private:
     //Fields
-    const size_t _init_capacity = 10;
     size_t _length = 0;
     size_t _capacity = 0;
+    size_t _head = 0;
     pointer _array = nullptr;
+    Alloc _alloc;
+    Growth _growth;
+    [[no_unique_address]] Stats _stats;
 
     //Private methods
     
-    //Change length, capacity, array and if _Arr is nullptr allocate new memory
-    void _change_Array(pointer _Arr, size_t _Len, size_t _Cap)
+    //Change length, capacity, array, head and if _Arr is nullptr allocate new memory
+    void _change_Array(pointer _Arr, size_t _Len, size_t _Cap, size_t _Head = 0)
     {
         if (!_Arr) this->_allocate(_Cap);
         else this->_array = _Arr, this->_capacity = _Cap;
 
         this->_length = _Len;
+        this->_head = _Head;
+    }
+
+    //Handle of the array's allocator as the slots keep it
+    handle_type _slot_Handle() const noexcept
+    {
+        return this->_stats.bind(this->_alloc.handle());
+    }
+
+    //First element, elements live at [_head, _head + _length) of _array
+    pointer _first() const noexcept
+    {
+        return this->_array + this->_head;
     }
 
-    //Allocate array of nullptrs if _new_Capacity > 0 otherwise _array = nullptr, set new capacity
+    //Wrapper is trivially relocatable: it is a pointer plus a trivially copyable handle,
+    //so the array keeps it in raw storage and moves slots around as bytes.
+    //Only the slots at [_head, _head + _length) hold constructed Wrappers, the rest of the capacity is uninitialized
+
+    //Allocate uninitialized storage if _new_Capacity > 0 otherwise _array = nullptr, set new capacity
     void _allocate(size_t _new_Capacity)
     {
-        this->_array = _new_Capacity > 0 ?
-            new value_type[_new_Capacity]
-            : nullptr;
+        this->_array = nullptr;
+        this->_capacity = 0;
+
+        if (_new_Capacity > 0)
+            this->_reallocate(_new_Capacity);
+    }
+
+    //Resize the storage, realloc carries the bytes of the slots over
+    void _reallocate(size_t _new_Capacity)
+    {
+        static_assert(std::is_trivially_copyable_v<handle_type>, "Allocator handles must be trivially copyable");
+        static_assert(alignof(value_type) <= alignof(std::max_align_t));
 
+        if (_new_Capacity > max_size())
+            throw std::length_error("Capacity of the array is too big");
+
+        size_t bytes = _new_Capacity * sizeof(value_type);
+        void* memory = std::realloc(static_cast<void*>(this->_array), bytes);
+        if (!memory)
+            throw std::bad_alloc();
+
+        if (this->_array) this->_stats.reallocated(_new_Capacity, bytes);
+        else this->_stats.allocated(_new_Capacity, bytes);
+
+        this->_array = static_cast<pointer>(memory);
         this->_capacity = _new_Capacity;
     }
+
+    //Construct empty slots bound to the handle of the array's allocator
+    void _construct_Slots(pointer _First, size_t _Count) noexcept
+    {
+        for (size_t i = 0; i < _Count; ++i)
+            std::construct_at(_First + i, this->_slot_Handle());
+    }
+
+    //Move the slots at [_First, _Last) to _Dest, the ranges may overlap and the source is left uninitialized
+    void _move_Slots(pointer _First, pointer _Last, pointer _Dest) noexcept
+    {
+        if (_First != _Dest && _First != _Last)
+        {
+            std::memmove(static_cast<void*>(_Dest), static_cast<void const*>(_First), (_Last - _First) * sizeof(value_type));
+            this->_stats.moved(_Last - _First);
+        }
+    }
     
-    //Delete all the pointers and set _array to nullptr
+    //Destroy the elements and free the storage
     void _deallocate()
     {
-        //Clear all the data pointer points at
-        delete[] this->_array;
+        std::destroy(this->_first(), this->_first() + this->_length);
+        std::free(static_cast<void*>(this->_array));
+    }
+
+    //Give back the storage grown past _Capacity, e.g. after a failed insertion. Keeps it if shrinking fails
+    void _restore_Capacity(size_t _Capacity) noexcept
+    {
+        if (this->_capacity <= _Capacity)
+            return;
+
+        try
+        {
+            if (!_Capacity)
+            {
+                std::free(static_cast<void*>(this->_array));
+                this->_change_Array(nullptr, 0, 0);
+            }
+            else this->_relocate(_Capacity, 0, this->_length, 0);
+        }
+        catch (...) { }
     }
 
     //Check whether _array is full of elements
@@ -59,27 +160,62 @@ private:
         return this->_length >= this->_capacity;
     }
 
-    //Double capacity -> move to new array -> assign
-    void _expandAndMove()
+    //Place the elements so that they start at _new_Head and _Gap_Size uninitialized slots are left before element _Gap_Index.
+    //A bigger array is realloc'ed first and the elements are moved inside it, a smaller one is shrunk last
+    void _relocate(size_t _new_Capacity, size_t _new_Head, size_t _Gap_Index, size_t _Gap_Size)
     {
-        size_t newCapacity = (this->_capacity + 1) << 1;
+        if (_new_Capacity > this->_capacity)
+            this->_reallocate(_new_Capacity);
 
-        auto newArray = new value_type[newCapacity];
-        std::ranges::move(*this, newArray);
+        pointer first = this->_first();
+        pointer gap = first + _Gap_Index;
+        pointer last = first + this->_length;
+        pointer newGap = this->_array + _new_Head + _Gap_Index + _Gap_Size;
 
-        this->_deallocate();
-        this->_change_Array(newArray, this->_length, newCapacity);
+        if (_new_Head < this->_head)
+        {
+            //Prefix goes to the left first, then the suffix is free to go either way
+            this->_move_Slots(first, gap, this->_array + _new_Head);
+            this->_move_Slots(gap, last, newGap);
+        }
+        else
+        {
+            //Suffix goes to the right first, then the prefix follows
+            this->_move_Slots(gap, last, newGap);
+            this->_move_Slots(first, gap, this->_array + _new_Head);
+        }
+
+        this->_head = _new_Head;
+
+        if (_new_Capacity < this->_capacity)
+            this->_reallocate(_new_Capacity);
     }
 
-    void _expandAndMove(size_t _Total_Capacity)
+    //Free _Count slots before element _Index by shifting the shorter side of the array, the slots come back empty.
+    //When that side has no room the elements are re-centred (front) or pulled to the start (back),
+    //growing the array if less than half of it would stay free, so pushing to either end is amortized O(1)
+    void _make_Gap(size_t _Index, size_t _Count)
     {
-        size_t newCapacity = (_Total_Capacity + 1) << 1;
+        bool front = _Index < this->_length - _Index;
+        size_t tail = this->_capacity - this->_head - this->_length;
+
+        if (front ? this->_head >= _Count : tail >= _Count)
+            this->_relocate(this->_capacity, front ? this->_head - _Count : this->_head, _Index, _Count);
+        else
+        {
+            if (_Count > max_size() - this->_length)
+                throw std::length_error("Capacity of the array is too big");
 
-        auto newArray = new value_type[newCapacity];
-        std::ranges::move(*this, newArray);
+            //Whatever the policy returns stays within [length, max_size()]
+            size_t length = this->_length + _Count;
+            size_t capacity = this->_capacity >= length + this->_length
+                ? this->_capacity
+                : std::clamp(this->_growth(this->_capacity, length), length, max_size());
 
-        this->_deallocate();
-        this->_change_Array(newArray, this->_length, newCapacity);
+            this->_relocate(capacity, front ? (capacity - length) / 2 : 0, _Index, _Count);
+        }
+
+        this->_construct_Slots(this->_first() + _Index, _Count);
     }
 
     template<typename... Args>
@@ -89,12 +225,115 @@ private:
         this->_length += sizeof...(elems);
     }
 
+    //Put an element of an inserted range into an empty slot: rvalues hand their data over, lvalues are cloned
+    template<typename Elem>
+    void _store_Element(Wrapper& _Slot, Elem&& _Elem)
+    {
+        using elem_type = std::remove_cvref_t<Elem>;
+        constexpr bool owned = !std::is_lvalue_reference_v<Elem&&>;
+        auto handle = this->_slot_Handle();
+
+        if constexpr (std::is_same_v<elem_type, Wrapper> || _foreign_Wrapper<elem_type, Wrapper>)
+        {
+            if constexpr (owned) _Slot = std::move(_Elem);
+            else _Slot._data = _Elem._data ? handle.clone(*_Elem._data) : nullptr;
+        }
+        else if constexpr (_is_unique_ptr<elem_type>)
+        {
+            if constexpr (owned) _Slot._data = handle.adopt(static_cast<T*>(_Elem.release()));
+            else _Slot._data = _Elem ? handle.clone(static_cast<T const&>(*_Elem)) : nullptr;
+        }
+        else
+        {
+            T* ptr = _Elem;
+            if constexpr (owned) _Slot._data = handle.adopt(ptr);
+            else _Slot._data = ptr ? handle.clone(*ptr) : nullptr;
+        }
+    }
+
+    //Move the data of a Wrapper of another instantiation into _Slot. Pointees can only be handed over
+    //when both use the same allocator, otherwise they are cloned with _Slot's handle and the source destroys its own
+    template<typename W>
+    static constexpr void _take_Foreign(Wrapper& _Slot, W& _Other) noexcept
+    {
+        using alloc_handle = typename Alloc::handle_type;
+        using other_alloc = typename W::container_type::allocator_type;
+
+        if (_Slot._data == _Other._data)
+            return;
+
+        _Slot._handle().destroy(_Slot._data);
+
+        bool same = false;
+        if constexpr (std::is_same_v<other_alloc, Alloc>)
+            same = static_cast<alloc_handle const&>(_Slot._handle()).same(static_cast<alloc_handle const&>(_Other._handle()));
+
+        if (same)
+            _Slot._data = _Other._data;
+        else
+        {
+            _Slot._data = _Other._data ? _Slot._handle().clone(*_Other._data) : nullptr;
+            _Other._handle().destroy(_Other._data);
+        }
+
+        _Other._data = nullptr;
+    }
+
+    //Key of an element under the projection
+    template<typename Proj>
+    using _Key_t = std::remove_cvref_t<std::invoke_result_t<Proj&, T const*>>;
+
+    //Compute the projection once per element into a contiguous (key, index) buffer
+    template<typename Proj>
+    std::vector<std::pair<_Key_t<Proj>, size_t>> _extract_Keys(Proj& _Proj) const
+    {
+        std::vector<std::pair<_Key_t<Proj>, size_t>> keys;
+        keys.reserve(this->_length);
+
+        for (size_t i = 0; i < this->_length; ++i)
+            keys.emplace_back(std::invoke(_Proj, static_cast<T const*>(this->_first()[i]._data)), i);
+
+        return keys;
+    }
+
+    //Put element that was at _Keys[i].second into slot i, following the cycles of the permutation.
+    //Only the pointers move: every slot of the array carries the same handle
+    template<typename Key>
+    void _apply_Order(std::vector<std::pair<Key, size_t>>& _Keys) noexcept
+    {
+        for (size_t i = 0; i < _Keys.size(); ++i)
+        {
+            if (_Keys[i].second == i)
+                continue;
+
+            pointer first = this->_first();
+            T* temp = first[i]._data;
+            size_t j = i;
+            while (_Keys[j].second != i)
+            {
+                size_t next = _Keys[j].second;
+                first[j]._data = first[next]._data;
+                _Keys[j].second = j;
+                j = next;
+            }
+
+            first[j]._data = temp;
+            _Keys[j].second = j;
+        }
+    }
+
 public:
     //Define wrapper for T pointer to handle the assignment operator for dereferenced iterators properly
     //Wrapper allows for an array to be working with STL library algorithms
-    struct Wrapper
+    //The allocator handle is an (often empty) base, so with HeapAllocator Wrapper is a single pointer
+    struct Wrapper : private handle_type
     {
     private:
+        friend class PtrArray;
+
+        template<cloneable, typename, typename, typename>
+        friend class PtrArray;
+
         //Aliases
         using value_type = T;
         using pointer = value_type*;
@@ -103,87 +342,129 @@ public:
         //Pointer at data
         pointer _data = nullptr;
 
+        constexpr handle_type& _handle() noexcept { return *this; }
+        constexpr handle_type const& _handle() const noexcept { return *this; }
+
     public:
+        using container_type = PtrArray;
+
         //Constructors
-        explicit Wrapper() noexcept = default;
+        constexpr explicit Wrapper() noexcept = default;
 
-        explicit Wrapper(pointer const& _ptr) noexcept
+        constexpr explicit Wrapper(handle_type const& _Handle) noexcept
+            : handle_type(_Handle)
+        { }
+
+        constexpr explicit Wrapper(pointer const& _ptr, handle_type const& _Handle = {}) noexcept
             //To copy data we need to clone it if there is something in 'ptr'
-            : _data(_ptr ? _ptr->clone() : nullptr)
+            : handle_type(_Handle), _data(_ptr ? this->_handle().clone(*_ptr) : nullptr)
         { }
 
-        explicit Wrapper(pointer&& _ptr) noexcept
-            : _data(std::move(_ptr))
+        constexpr explicit Wrapper(pointer&& _ptr, handle_type const& _Handle = {}) noexcept
+            : handle_type(_Handle), _data(this->_handle().adopt(_ptr))
         { _ptr = nullptr; }
 
-        Wrapper(Wrapper const& other) noexcept
-            : _data(other._data ? other._data->clone() : nullptr)
+        //Copies are detached from the source's allocator so they may outlive its array
+        constexpr Wrapper(Wrapper const& other) noexcept
+            : _data(other._data ? this->_handle().clone(*other._data) : nullptr)
         { }
 
-        Wrapper(Wrapper&& other) noexcept
-            : _data(std::move(other._data))
+        constexpr Wrapper(Wrapper&& other) noexcept
+            : handle_type(other._handle()), _data(std::move(other._data))
         { other._data = nullptr; }
 
-        ~Wrapper()
+        constexpr ~Wrapper()
         {
-            delete this->_data;
+            this->_handle().destroy(this->_data);
         }
 
         //Allow implicit conversion to T*
-        explicit(false) operator pointer() const { return this->_data; }
+        constexpr explicit(false) operator pointer() const { return this->_data; }
 
         //Copy and move assignment operators for other object of 'Wrapper' type
-        Wrapper& operator=(Wrapper const& other) noexcept
+        //Assignments keep the own handle: new data is cloned or adopted with it
+        constexpr Wrapper& operator=(Wrapper const& other) noexcept
         {
-            delete this->_data;
+            if (this != &other)
+            {
+                this->_handle().destroy(this->_data);
+                this->_data = other._data ? this->_handle().clone(*other._data) : nullptr;
+            }
 
-            this->_data = other._data ? other._data->clone() : nullptr;
             return *this;
         }
 
-        Wrapper& operator=(Wrapper&& other) noexcept
+        constexpr Wrapper& operator=(Wrapper&& other) noexcept
         {
             if (this->_data != other._data)
             {
-                delete this->_data;
+                this->_handle().destroy(this->_data);
+
+                //Data made by a different allocator has to be re-homed into ours
+                if (this->_handle().same(other._handle()))
+                    this->_data = other._data;
+                else
+                {
+                    this->_data = other._data ? this->_handle().clone(*other._data) : nullptr;
+                    other._handle().destroy(other._data);
+                }
 
-                this->_data = other._data;
                 other._data = nullptr;
             }
 
             return *this;
         }
 
+        //Assignment from a Wrapper of another PtrArray instantiation: lvalues are cloned, rvalues are re-homed the same way
+        template<typename W>
+            requires _foreign_Wrapper<std::remove_cvref_t<W>, Wrapper> && std::convertible_to<W&&, pointer>
+        constexpr Wrapper& operator=(W&& other) noexcept
+        {
+            if constexpr (std::is_lvalue_reference_v<W> || std::is_const_v<std::remove_reference_t<W>>)
+            {
+                pointer ptr = other;
+                return *this = ptr;
+            }
+            else
+            {
+                PtrArray::_take_Foreign(*this, other);
+                return *this;
+            }
+        }
+
         //Copy assignment operators for T* type
-        Wrapper& operator=(pointer const& ptr) noexcept
+        constexpr Wrapper& operator=(pointer const& ptr) noexcept
         {
             if (this->_data != ptr)
             {
-                delete this->_data;
-                this->_data = ptr ? ptr->clone() : nullptr;
+                this->_handle().destroy(this->_data);
+                this->_data = ptr ? this->_handle().clone(*ptr) : nullptr;
             }
 
             return *this;
         }
 
         //Move assignment operator for pointer to avoid memory leak when assigning rvalue reference
-        Wrapper& operator=(pointer&& ptr) noexcept
+        constexpr Wrapper& operator=(pointer&& ptr) noexcept
         {
-            delete this->_data;
-            this->_data = std::move(ptr);
+            if (this->_data != ptr)
+            {
+                this->_handle().destroy(this->_data);
+                this->_data = this->_handle().adopt(ptr);
+            }
 
             ptr = nullptr;
             return *this;
         }
 
         //Overload '->' to get access to data without converting
-        pointer operator->() const
+        constexpr pointer operator->() const
         {
             return this->_data;
         }
 
         //Implement spaceship operator to compare 'Wrapper's without converting to 'T*'
-        std::strong_ordering operator<=>(Wrapper const& other) const noexcept
+        constexpr std::strong_ordering operator<=>(Wrapper const& other) const noexcept
         {
             if (!_data && !other._data)
                 return std::strong_ordering::equivalent;
@@ -194,11 +475,24 @@ public:
             if (!other._data)
                 return std::strong_ordering::greater;
 
-            if (*_data < *other._data)
-                return std::strong_ordering::less;
+            //One three-way comparison when T has it
+            if constexpr (std::three_way_comparable<T>)
+            {
+                auto cmp = *_data <=> *other._data;
+                if (cmp < 0)
+                    return std::strong_ordering::less;
 
-            if (*_data > *other._data)
-                return std::strong_ordering::greater;
+                if (cmp > 0)
+                    return std::strong_ordering::greater;
+            }
+            else
+            {
+                if (*_data < *other._data)
+                    return std::strong_ordering::less;
+
+                if (*_data > *other._data)
+                    return std::strong_ordering::greater;
+            }
 
             return std::strong_ordering::equivalent;
         }
@@ -219,31 +513,31 @@ public:
         using reference = value_type&;
 
         //Constructors
-        Iterator() : m_ptr(nullptr) { }
+        constexpr Iterator() : m_ptr(nullptr) { }
 
-        explicit Iterator(Wrapper* m_ptr) : m_ptr(m_ptr) { };
+        constexpr explicit Iterator(Wrapper* m_ptr) : m_ptr(m_ptr) { };
 
         //Accesssors
-        reference operator*() const { return *m_ptr; }
-        T* operator->() { return *m_ptr; }
+        constexpr reference operator*() const { return *m_ptr; }
+        constexpr T* operator->() const { return *m_ptr; }
 
-        reference operator[] (const int& ind) const { return this->m_ptr[ind]; }
+        constexpr reference operator[] (difference_type ind) const { return this->m_ptr[ind]; }
 
         //Arithmetic
-        Iterator& operator++() { ++m_ptr;  return *this; }
-        Iterator& operator--() { --m_ptr;  return *this; }
+        constexpr Iterator& operator++() { ++m_ptr;  return *this; }
+        constexpr Iterator& operator--() { --m_ptr;  return *this; }
 
-        Iterator operator++(int) { auto temp = *this; ++m_ptr;  return temp; }
-        Iterator operator--(int) { auto temp = *this; --m_ptr;  return temp; }
+        constexpr Iterator operator++(int) { auto temp = *this; ++m_ptr;  return temp; }
+        constexpr Iterator operator--(int) { auto temp = *this; --m_ptr;  return temp; }
 
-        Iterator operator+(difference_type n) const { return Iterator(m_ptr + n); }
-        Iterator operator-(difference_type n) const { return Iterator(m_ptr - n); }
+        constexpr Iterator operator+(difference_type n) const { return Iterator(m_ptr + n); }
+        constexpr Iterator operator-(difference_type n) const { return Iterator(m_ptr - n); }
  
-        Iterator& operator+=(difference_type n) { m_ptr += n; return *this; }
-        Iterator& operator-=(difference_type n) { m_ptr -= n; return *this; }
+        constexpr Iterator& operator+=(difference_type n) { m_ptr += n; return *this; }
+        constexpr Iterator& operator-=(difference_type n) { m_ptr -= n; return *this; }
 
-        static friend Iterator operator+(difference_type n, Iterator other) { return Iterator(m_ptr + n); }
-        difference_type operator-(Iterator const& rhs) const { return m_ptr - rhs.m_ptr; }
+        friend constexpr Iterator operator+(difference_type n, Iterator other) { return other + n; }
+        constexpr difference_type operator-(Iterator const& rhs) const { return m_ptr - rhs.m_ptr; }
        
         //Comparison
         std::strong_ordering operator<=>(Iterator const& rhs) const = default;
@@ -253,52 +547,113 @@ public:
     PtrArray()
     { this->_allocate(this->_capacity); }
 
-    PtrArray(PtrArray<T> const& other)
+    explicit PtrArray(Alloc const& _Alloc, Growth const& _Growth = {})
+        : _alloc(_Alloc), _growth(_Growth)
+    { this->_allocate(this->_capacity); }
+
+    PtrArray(PtrArray const& other)
+        : _alloc(other._alloc), _growth(other._growth), _stats(other._stats)
     {
         this->operator=(other);
     }
 
-    PtrArray(PtrArray<T>&& other) noexcept
+    //Deep copy that clones the elements concurrently on the pool
+    PtrArray(PtrArray const& other, ThreadPool& pool)
+        : _alloc(other._alloc), _growth(other._growth), _stats(other._stats)
     {
-        this->operator=(std::move(other));
+        this->clone_from(other, pool);
+    }
+
+    PtrArray(PtrArray&& other) noexcept
+        : _alloc(std::move(other._alloc)), _growth(other._growth), _stats(std::move(other._stats))
+    {
+        this->_change_Array(other._array, other._length, other._capacity, other._head);
+        other._change_Array(nullptr, 0, 0);
     }
 
     template<typename... Args>
+        requires (std::convertible_to<Args, T*> && ...)
     explicit PtrArray(Args&&... elems) noexcept
     {
         size_t size = sizeof...(elems);
         this->_allocate(size);
+        this->_construct_Slots(this->_array, size);
 
         this->_Emplace_elements(this->begin(), std::forward<Args>(elems)...);
     }
 
     //Copy and assignment operators
-    PtrArray<T>& operator=(PtrArray<T> const& other)
+    PtrArray& operator=(PtrArray const& other)
     {
+        if (this == &other)
+            return *this;
+
         this->_deallocate();
-        if (!other.empty())
-        {
-            this->_allocate(other._capacity);
-            std::copy(other.begin(), other.begin() + other._capacity, this->begin());
-        }
-        else this->_array = nullptr;
+        this->_alloc.reset();
+        this->_change_Array(nullptr, 0, 0);
+        this->_growth = other._growth;
 
+        this->_allocate(other._capacity);
+        this->_construct_Slots(this->_array, other._length);
         this->_length = other._length;
-        this->_capacity = other._capacity;
+
+        std::copy(other.begin(), other.end(), this->begin());
         return *this;
     }
 
-    PtrArray<T>& operator=(PtrArray<T>&& other) noexcept
+    PtrArray& operator=(PtrArray&& other) noexcept
     {
-        //Move data from other to current object
+        //Move data from other to current object, pointees stay with the allocator that made them
         this->_deallocate();
-        this->_change_Array(other._array, other._length, other._capacity);
+        this->_alloc = std::move(other._alloc);
+        this->_growth = other._growth;
+        this->_stats = std::move(other._stats);
+        this->_change_Array(other._array, other._length, other._capacity, other._head);
 
         //Clear the other
         other._change_Array(nullptr, 0, 0);
         return *this;
     }
 
+    //Replace the content with clones of other's elements made in parallel chunks.
+    //The array is allocated once with other's length; if a clone throws, the clones made so far are destroyed.
+    //Allocators that are not thread-safe clone on the calling thread
+    void clone_from(PtrArray const& other, ThreadPool& pool)
+    {
+        if (this == &other)
+            return;
+
+        this->_deallocate();
+        this->_alloc.reset();
+        this->_change_Array(nullptr, 0, 0);
+        this->_allocate(other._length);
+        this->_construct_Slots(this->_array, other._length);
+        this->_length = other._length;
+
+        auto clone_chunk = [this, &other](size_t first, size_t last)
+        {
+            auto handle = this->_slot_Handle();
+            for (size_t i = first; i < last; ++i)
+                if (T const* elem = other._first()[i]._data)
+                    this->_first()[i]._data = handle.clone(*elem);
+        };
+
+        try
+        {
+            if constexpr (Alloc::concurrent_clone)
+                _parallel_Chunks(other._length, pool, clone_chunk);
+            else
+                clone_chunk(0, other._length);
+        }
+        catch (...)
+        {
+            this->_deallocate();
+            this->_alloc.reset();
+            this->_change_Array(nullptr, 0, 0);
+            throw;
+        }
+    }
+
     ~PtrArray()
     {
         this->_deallocate();
@@ -309,18 +664,12 @@ public:
     void emplace(Iterator position, Args&&... elems)
     {
         size_t index = position - this->begin();
-        size_t size = sizeof...(elems);
-        if (this->_length + size > this->_capacity)
-        {
-            this->_expandAndMove(this->_length + size);
-            position = this->begin() + index;
-        }
 
         // Move elements to make space for the new element
-        std::move_backward(position, this->end(), this->end() + size);
+        this->_make_Gap(index, sizeof...(elems));
 
         //Emplace object at a now-freed position
-        this->_Emplace_elements(position, std::forward<Args>(elems)...);
+        this->_Emplace_elements(this->begin() + index, std::forward<Args>(elems)...);
     }
 
     template <typename... Args>
@@ -329,27 +678,76 @@ public:
         this->emplace(this->end(), std::forward<Args>(elems)...);
     }
 
+    template <typename... Args>
+    void emplace_front(Args&&... elems)
+    {
+        this->emplace(this->begin(), std::forward<Args>(elems)...);
+    }
+
+    //Construct a new U with the array's allocator right at the position, no clone is involved
+    template <std::derived_from<T> U, typename... Args>
+    void emplace_new(Iterator position, Args&&... args)
+    {
+        size_t index = position - this->begin();
+        this->emplace(position, static_cast<T*>(nullptr));
+
+        try
+        {
+            this->_first()[index]._data = this->_slot_Handle().template make<U>(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            this->erase(this->begin() + index);
+            throw;
+        }
+    }
+
+    template <std::derived_from<T> U, typename... Args>
+    void emplace_back_new(Args&&... args)
+    {
+        this->emplace_new<U>(this->end(), std::forward<Args>(args)...);
+    }
+
     template<typename U>
     void push_back(U&& obj)
     {
         this->emplace(this->end(), std::forward<U>(obj));
     }
 
+    template<typename U>
+    void push_front(U&& obj)
+    {
+        this->emplace(this->begin(), std::forward<U>(obj));
+    }
+
     //Erase elements at [_First, _Last)
     void erase(Iterator _First, Iterator _Last)
     {
         if (this->empty() || _First < this->begin() || _Last > this->end() || _First >= _Last)
             return;
 
-        //Shift data after _Last to the left 
-        std::move(_Last, this->end(), _First);
-
-        //nullptr the now-dangled pointers
         auto _dist = std::distance(_First, _Last);
-        for (decltype(_dist) i = 0; i < _dist; ++i)
-            *(this->end() - i - 1) = nullptr;
+        pointer first = this->_first() + (_First - this->begin());
+        pointer last = first + _dist;
+
+        //Destroy the erased elements in one go, their slots are then overwritten by the shorter side
+        std::destroy(first, last);
+
+        if (_First - this->begin() < this->end() - _Last)
+        {
+            //Shift data before _First to the right and move the head
+            this->_move_Slots(this->_first(), first, this->_first() + _dist);
+            this->_head += _dist;
+        }
+        else
+        {
+            //Shift data after _Last to the left
+            this->_move_Slots(last, this->_first() + this->_length, first);
+        }
 
         this->_length -= _dist;
+        if (!this->_length)
+            this->_head = 0;
     }
 
     void erase(Iterator position)
@@ -357,17 +755,289 @@ public:
         this->erase(position, position + 1);
     }
 
+    void pop_front()
+    {
+        this->erase(this->begin());
+    }
+
+    void pop_back()
+    {
+        this->erase(this->end() - 1);
+    }
+
+    //Move the elements rejected by the predicate behind the rest in a single pass, the survivors keep their order.
+    //Unlike std::remove_if the rejected elements stay valid at [result, end()) until they are erased
+    template<typename Pred>
+    Iterator remove_if(Pred pred)
+    {
+        pointer first = this->_first();
+        pointer last = first + this->_length;
+        pointer out = first;
+
+        //Only the pointers are swapped: every slot of the array carries the same handle
+        for (pointer it = first; it != last; ++it)
+            if (!std::invoke(pred, static_cast<T const*>(it->_data)))
+                std::swap(out++->_data, it->_data);
+
+        return Iterator(out);
+    }
+
+    //Erase the elements the predicate holds for, the rejected pointees are destroyed in one batch.
+    //Returns the number of erased elements
+    template<typename Pred>
+    size_t erase_if(Pred pred)
+    {
+        auto first = this->remove_if(std::move(pred));
+        size_t removed = this->end() - first;
+
+        this->erase(first, this->end());
+        return removed;
+    }
+
+    //Bulk insertion of ranges of T*, std::unique_ptr<T> or Wrapper.
+    //The array grows at most once and the tail is shifted once; rvalue elements (e.g. through std::move_iterator
+    //or std::views::as_rvalue) hand their ownership over, lvalue ones are cloned. The range must not refer to this array
+
+    template<std::ranges::input_range R>
+        requires std::ranges::forward_range<R> || std::ranges::sized_range<R>
+    Iterator insert_range(Iterator position, R&& range)
+    {
+        size_t index = position - this->begin();
+        size_t count = std::ranges::distance(range);
+
+        this->_make_Gap(index, count);
+        this->_length += count;
+
+        try
+        {
+            auto it = std::ranges::begin(range);
+            for (size_t i = 0; i < count; ++it, ++i)
+                this->_store_Element(this->_first()[index + i], *it);
+        }
+        catch (...)
+        {
+            //Drop what has been inserted so far and close the gap
+            this->erase(this->begin() + index, this->begin() + index + count);
+            throw;
+        }
+
+        return this->begin() + index;
+    }
+
+    template<std::input_iterator It, std::sentinel_for<It> S>
+    Iterator insert(Iterator position, It first, S last)
+    {
+        return this->insert_range(position, std::ranges::subrange(std::move(first), std::move(last)));
+    }
+
+    template<std::ranges::input_range R>
+    void append_range(R&& range)
+    {
+        this->insert_range(this->end(), std::forward<R>(range));
+    }
+
+    //Replace the content with the range, the array keeps its memory
+    template<std::ranges::input_range R>
+    void assign_range(R&& range)
+    {
+        this->erase(this->begin(), this->end());
+        this->insert_range(this->end(), std::forward<R>(range));
+    }
+
+    //Call fn with every element (as T*) in order, prefetching the pointee _Distance elements ahead.
+    //The default distance depends on the size of the array, 0 turns prefetching off
+    template<typename Fn>
+    void for_each_prefetched(Fn fn, size_t _Distance = prefetch_auto) const
+    {
+        pointer first = this->_first();
+        if (_Distance == prefetch_auto)
+            _Distance = prefetch_distance(this->_length, sizeof(value_type) + sizeof(T));
+
+        size_t ahead = std::min(_Distance, this->_length);
+        for (size_t i = 0; i < ahead; ++i)
+            prefetch_read(first[i]._data);
+
+        size_t i = 0;
+        for (; i + ahead < this->_length; ++i)
+        {
+            prefetch_read(first[i + ahead]._data);
+            std::invoke(fn, first[i]._data);
+        }
+
+        for (; i < this->_length; ++i)
+            std::invoke(fn, first[i]._data);
+    }
+
+    //Serialization in the binary format of Serialization.cpp, dynamic types are looked up in the registry
+
+    void save(std::ostream& stream, TypeRegistry<T> const& registry = TypeRegistry<T>::instance()) const
+    {
+        binary_write(stream, serialization_magic);
+        binary_write(stream, serialization_version);
+        binary_write<uint64_t>(stream, this->_length);
+
+        for (size_t i = 0; i < this->_length; ++i)
+            registry.write(stream, this->_first()[i]._data);
+
+        if (!stream)
+            throw std::runtime_error("Failed to write the array");
+    }
+
+    //Append the elements stored in the stream. The array grows once, elements are read in batches
+    //and, with an arena allocator, constructed right in the arena. Nothing is appended if it throws
+    void load(std::istream& stream, TypeRegistry<T> const& registry = TypeRegistry<T>::instance())
+    {
+        if (binary_read<uint32_t>(stream) != serialization_magic || binary_read<uint32_t>(stream) != serialization_version)
+            throw std::runtime_error("Stream does not hold an array of this format");
+
+        //The count comes from the file: it is checked against the array and the stream
+        //(every element takes at least its tag) and the array grows batch by batch through the growth policy
+        uint64_t count = binary_read<uint64_t>(stream);
+        if (count > max_size() - this->_length)
+            throw std::length_error("Stream holds more elements than the array can take");
+
+        if (count > binary_remaining(stream) / sizeof(uint32_t))
+            throw std::runtime_error("Stream is too short for the element count in its header");
+
+        size_t start = this->_length;
+        size_t capacity = this->_capacity;
+
+        Arena* arena = nullptr;
+        if constexpr (requires { this->_alloc.arena(); })
+            arena = this->_alloc.arena();
+
+        constexpr size_t batch_size = 256;
+        T* batch[batch_size];
+        auto handle = this->_slot_Handle();
+
+        for (size_t done = 0; done < count; )
+        {
+            size_t size = std::min(batch_size, count - done);
+            size_t read = 0;
+            size_t stored = 0;
+            bool placed = false;
+
+            try
+            {
+                for (; read < size; ++read)
+                    batch[read] = registry.read(stream, arena);
+
+                this->_make_Gap(this->_length, size);
+                this->_length += size;
+                placed = true;
+
+                //Objects read into the arena already belong to the array
+                for (pointer slot = this->_first() + this->_length - size; stored < size; ++stored)
+                    slot[stored]._data = arena ? batch[stored] : handle.adopt(batch[stored]);
+            }
+            catch (...)
+            {
+                //adopt() takes the object even when it throws
+                for (size_t i = placed ? stored + 1 : 0; i < read; ++i)
+                    handle.destroy(batch[i]);
+
+                this->erase(this->begin() + start, this->end());
+                this->_restore_Capacity(capacity);
+                throw;
+            }
+
+            done += size;
+        }
+    }
+
+    //Projection algorithms: the projection is called with 'T const*' once per element,
+    //keys are ordered in a contiguous buffer and the slots are permuted in a single pass
+
+    template<typename Proj, typename Comp = std::ranges::less>
+    void sort_by(Proj proj, Comp comp = {})
+    {
+        auto keys = this->_extract_Keys(proj);
+        std::ranges::sort(keys, comp, &std::pair<_Key_t<Proj>, size_t>::first);
+        this->_apply_Order(keys);
+    }
+
+    //Elements with equal keys keep their relative order
+    template<typename Proj, typename Comp = std::ranges::less>
+    void stable_sort_by(Proj proj, Comp comp = {})
+    {
+        auto keys = this->_extract_Keys(proj);
+        std::ranges::stable_sort(keys, comp, &std::pair<_Key_t<Proj>, size_t>::first);
+        this->_apply_Order(keys);
+    }
+
+    //Partition the array so that 'nth' holds the element that would be there if it was sorted
+    template<typename Proj, typename Comp = std::ranges::less>
+    void nth_element_by(Iterator nth, Proj proj, Comp comp = {})
+    {
+        if (nth >= this->end())
+            return;
+
+        auto keys = this->_extract_Keys(proj);
+        std::ranges::nth_element(keys, keys.begin() + (nth - this->begin()), comp, &std::pair<_Key_t<Proj>, size_t>::first);
+        this->_apply_Order(keys);
+    }
+
+    //Binary search over an array sorted by the projection, evaluates it O(log n) times
+    template<typename Key, typename Proj, typename Comp = std::ranges::less>
+    Iterator lower_bound_by(Key const& key, Proj proj, Comp comp = {}) const
+    {
+        return std::ranges::lower_bound(this->begin(), this->end(), key, comp,
+            [&proj](Wrapper const& elem) -> decltype(auto) { return std::invoke(proj, static_cast<T const*>(elem)); });
+    }
+
     //Capacity
     size_t size() const noexcept
     {
         return this->_length;
     }
 
+    //Destroy the elements but keep the memory for the next fill
     void clear()
+    {
+        this->erase(this->begin(), this->end());
+        this->_alloc.reset();
+    }
+
+    //Destroy the elements and free the memory
+    void release()
     {
         this->_deallocate();
+        this->_alloc.reset();
+
+        this->_change_Array(nullptr, 0, 0);
+    }
+
+    size_t capacity() const noexcept
+    {
+        return this->_capacity;
+    }
+
+    //Most slots the array can have, the byte size of the storage has to fit in size_t
+    static constexpr size_t max_size() noexcept
+    {
+        return std::numeric_limits<size_t>::max() / sizeof(value_type);
+    }
+
+    //Make room for at least _new_Capacity elements
+    void reserve(size_t _new_Capacity)
+    {
+        if (_new_Capacity > max_size())
+            throw std::length_error("Capacity of the array is too big");
 
-        this->_change_Array(nullptr, 0, this->_init_capacity);
+        if (_new_Capacity > this->_capacity)
+            this->_relocate(_new_Capacity, 0, this->_length, 0);
+    }
+
+    //Give the unused slots back
+    void shrink_to_fit()
+    {
+        if (this->_length == this->_capacity)
+            return;
+
+        if (this->empty())
+            this->release();
+        else
+            this->_relocate(this->_length, 0, this->_length, 0);
     }
 
     bool empty() const noexcept
@@ -380,24 +1050,40 @@ public:
         if (index >= this->_length)
             throw std::out_of_range("Index of the array is out of the range");
 
-        return *this->_array[index];
+        return *this->_first()[index];
     }
 
     T* operator[](const size_t index) const noexcept
     {
         if (index >= this->_length)
-            return this->_array[0];
+            return this->_length ? this->_first()[0]._data : nullptr;
 
-        return this->_array[index];
+        return this->_first()[index];
+    }
+
+    Alloc const& get_allocator() const noexcept
+    {
+        return this->_alloc;
+    }
+
+    //Counters of the stats policy, all zero with NoStats
+    PtrArrayStats stats() const noexcept
+    {
+        return this->_stats.snapshot();
+    }
+
+    Stats& get_stats() noexcept
+    {
+        return this->_stats;
     }
 
     Iterator begin() const
     {
-        return Iterator(this->_array);
+        return Iterator(this->_first());
     }
 
     Iterator end() const
     {
-        return Iterator(this->_array + this->_length);
+        return Iterator(this->_first() + this->_length);
     }
 };
\ No newline at end of file
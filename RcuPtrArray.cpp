@@ -0,0 +1,157 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+#include "Epoch.cpp"
+
+//Array of pointers for many readers and a writer that runs alongside them (read-copy-update).
+//The writer changes a private PtrArray and publishes an immutable version of its pointers;
+//readers take a snapshot(), which pins the version it sees together with the pointees it references.
+//Replaced versions and erased pointees are reclaimed through the epoch domain once no snapshot can see them.
+//Reading takes no locks and no atomic operation per element.
+//Published objects must not be modified in place: replace them with new ones instead
+template <cloneable T>
+class RcuPtrArray
+{
+public:
+    using array_type = PtrArray<T, EpochAllocator>;
+    class Snapshot;
+
+private:
+    //Immutable list of the pointers that were in the array when it was published
+    struct Version
+    {
+        std::vector<T const*> elems;
+    };
+
+    //Fields
+    array_type _array;
+    std::atomic<Version*> _version;
+    std::mutex _writer_mutex;
+
+    //Private methods
+
+    //Make the current content of the writer's array visible to new snapshots
+    void _publish()
+    {
+        auto version = std::make_unique<Version>();
+        version->elems.assign(this->_array.begin(), this->_array.end());
+
+        auto& domain = EpochDomain::instance();
+        domain.retire(this->_version.exchange(version.release()));
+        domain.advance();
+        domain.reclaim();
+    }
+
+public:
+    //Consistent view of the array, valid until the snapshot is destroyed
+    class Snapshot
+    {
+    private:
+        friend class RcuPtrArray;
+
+        EpochGuard _guard;
+        Version const* _version;
+
+        explicit Snapshot(std::atomic<Version*> const& _Version)
+            : _guard(), _version(_Version.load())
+        { }
+
+    public:
+        using iterator = T const* const*;
+
+        size_t size() const noexcept
+        {
+            return this->_version->elems.size();
+        }
+
+        bool empty() const noexcept
+        {
+            return this->_version->elems.empty();
+        }
+
+        T const* operator[](const size_t index) const noexcept
+        {
+            return this->_version->elems[index];
+        }
+
+        iterator begin() const noexcept
+        {
+            return this->_version->elems.data();
+        }
+
+        iterator end() const noexcept
+        {
+            return this->_version->elems.data() + this->size();
+        }
+    };
+
+    //Constructors
+    RcuPtrArray()
+        : _version(new Version())
+    { }
+
+    RcuPtrArray(RcuPtrArray const&) = delete;
+    RcuPtrArray& operator=(RcuPtrArray const&) = delete;
+
+    //No snapshot may outlive the array
+    ~RcuPtrArray()
+    {
+        delete this->_version.load();
+        this->_array.release();
+
+        auto& domain = EpochDomain::instance();
+        domain.advance();
+        domain.reclaim();
+    }
+
+    //Readers
+
+    Snapshot snapshot() const
+    {
+        return Snapshot(this->_version);
+    }
+
+    size_t size() const
+    {
+        return this->snapshot().size();
+    }
+
+    //Writers, serialized among themselves
+
+    //Run _Fn on the writer's array and publish the result once.
+    //Every publish copies all the pointers, so bulk loads and other batches of changes belong in one update()
+    template<typename Fn>
+    void update(Fn _Fn)
+    {
+        std::lock_guard lock(this->_writer_mutex);
+        _Fn(this->_array);
+        this->_publish();
+    }
+
+    //Publishes a new version, O(size()): building an array one element at a time is quadratic, use update() instead
+    template<typename... Args>
+    void emplace_back(Args&&... elems)
+    {
+        this->update([&](array_type& arr) { arr.emplace_back(std::forward<Args>(elems)...); });
+    }
+
+    template<typename U>
+    void push_back(U&& obj)
+    {
+        this->emplace_back(std::forward<U>(obj));
+    }
+
+    template<typename Pred>
+    size_t erase_if(Pred pred)
+    {
+        size_t removed = 0;
+        this->update([&](array_type& arr) { removed = arr.erase_if(std::move(pred)); });
+
+        return removed;
+    }
+
+    void clear()
+    {
+        this->update([](array_type& arr) { arr.clear(); });
+    }
+};
@@ -0,0 +1,214 @@
+#pragma once
+#include "stdafx.h"
+
+//Queue of retired objects that are destroyed later, by drain()/flush() or by a background thread.
+//Moves destructor work of erased elements off the thread that erases them.
+//The reclaimer must outlive the arrays that retire objects into it
+class Reclaimer
+{
+private:
+    //Type-erased retired object
+    struct Retired
+    {
+        void* ptr;
+        void (*destroy)(void*);
+        size_t bytes;
+    };
+
+    //Fields
+    std::mutex _mutex;
+    std::vector<Retired> _queue;
+    std::atomic<size_t> _pending = 0;
+    std::atomic<size_t> _pending_bytes = 0;
+
+    //Serializes the drains so flush() waits for the one the background thread is running
+    std::mutex _drain_mutex;
+
+    std::thread _thread;
+    std::condition_variable _wake;
+    bool _stop = false;
+
+    //Private methods
+
+    //Size of the object by its dynamic type when T reports it through size_bytes(), by the static type otherwise
+    template<typename T>
+    static size_t _object_Bytes(T const* _Ptr) noexcept
+    {
+        if constexpr (requires { { _Ptr->size_bytes() } -> std::convertible_to<size_t>; })
+            return _Ptr->size_bytes();
+        else
+            return sizeof(T);
+    }
+
+    void _worker_Loop(std::chrono::milliseconds _Interval)
+    {
+        std::unique_lock lock(this->_mutex);
+        while (!this->_stop)
+        {
+            this->_wake.wait_for(lock, _Interval, [this] { return this->_stop; });
+
+            lock.unlock();
+            this->drain();
+            lock.lock();
+        }
+    }
+
+public:
+    static constexpr size_t npos = size_t(-1);
+
+    //Constructors
+
+    //Objects are destroyed only by drain() and flush()
+    Reclaimer() = default;
+
+    //Background thread drains the queue every _Interval
+    explicit Reclaimer(std::chrono::milliseconds _Interval)
+        : _thread(&Reclaimer::_worker_Loop, this, _Interval)
+    { }
+
+    Reclaimer(Reclaimer const&) = delete;
+    Reclaimer& operator=(Reclaimer const&) = delete;
+
+    ~Reclaimer()
+    {
+        this->flush();
+    }
+
+    //Reclaimer shared by the arrays that do not name their own
+    static Reclaimer& instance()
+    {
+        static Reclaimer reclaimer(std::chrono::milliseconds(10));
+        return reclaimer;
+    }
+
+    //Take over the object, it is deleted on a later drain. Its bytes are counted by _object_Bytes.
+    //Called from destructors, so it never throws: an object that can not be queued is deleted right away
+    template<typename T>
+    void retire(T* _Ptr) noexcept
+    {
+        if (!_Ptr)
+            return;
+
+        size_t bytes = _object_Bytes(_Ptr);
+        try
+        {
+            //Counted under the lock, so a drain that takes the object has always seen it counted
+            std::lock_guard lock(this->_mutex);
+            this->_queue.push_back({ _Ptr, [](void* ptr) { delete static_cast<T*>(ptr); }, bytes });
+            this->_pending.fetch_add(1, std::memory_order_relaxed);
+            this->_pending_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        catch (...)
+        {
+            delete _Ptr;
+        }
+    }
+
+    //Destroy up to _Max retired objects, oldest first; returns the number destroyed.
+    //Destructors run outside of the queue lock, so retiring never waits for them
+    size_t drain(size_t _Max = npos)
+    {
+        std::lock_guard drain_lock(this->_drain_mutex);
+
+        std::vector<Retired> batch;
+        {
+            std::lock_guard lock(this->_mutex);
+            if (_Max >= this->_queue.size())
+                batch.swap(this->_queue);
+            else
+            {
+                batch.assign(this->_queue.begin(), this->_queue.begin() + _Max);
+                this->_queue.erase(this->_queue.begin(), this->_queue.begin() + _Max);
+            }
+        }
+
+        size_t bytes = 0;
+        for (auto& retired : batch)
+        {
+            retired.destroy(retired.ptr);
+            bytes += retired.bytes;
+        }
+
+        this->_pending.fetch_sub(batch.size(), std::memory_order_relaxed);
+        this->_pending_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        return batch.size();
+    }
+
+    //Stop the background thread and destroy everything that is pending, for shutdown
+    void flush()
+    {
+        {
+            std::lock_guard lock(this->_mutex);
+            this->_stop = true;
+        }
+        this->_wake.notify_all();
+
+        if (this->_thread.joinable())
+            this->_thread.join();
+
+        while (this->drain());
+    }
+
+    //Number of objects waiting to be destroyed
+    size_t pending() const noexcept
+    {
+        return this->_pending.load(std::memory_order_relaxed);
+    }
+
+    //Bytes held by them, see retire() for how objects are measured
+    size_t pending_bytes() const noexcept
+    {
+        return this->_pending_bytes.load(std::memory_order_relaxed);
+    }
+};
+
+//Element policy that hands destroyed pointees over to a Reclaimer instead of deleting them on the spot.
+//Pointees are ordinary heap objects, so pointers moved between arrays never get re-homed
+class DeferredAllocator
+{
+public:
+    struct handle_type
+    {
+        //nullptr deletes right away, as detached Wrappers do
+        Reclaimer* reclaimer = nullptr;
+
+        template<typename T>
+        T* clone(T const& obj) const { return obj.clone(); }
+
+        template<typename U, typename... Args>
+        U* make(Args&&... args) const { return new U(std::forward<Args>(args)...); }
+
+        template<typename T>
+        T* adopt(T* ptr) const noexcept { return ptr; }
+
+        template<typename T>
+        void destroy(T* ptr) const noexcept
+        {
+            if (this->reclaimer) this->reclaimer->retire(ptr);
+            else delete ptr;
+        }
+
+        bool same(handle_type const&) const noexcept { return true; }
+    };
+
+private:
+    Reclaimer* _reclaimer;
+
+public:
+    static constexpr bool concurrent_clone = true;
+
+    //Constructors
+    DeferredAllocator()
+        : DeferredAllocator(Reclaimer::instance())
+    { }
+
+    explicit DeferredAllocator(Reclaimer& _Reclaimer) noexcept
+        : _reclaimer(&_Reclaimer)
+    { }
+
+    handle_type handle() const noexcept { return { this->_reclaimer }; }
+
+    void reset() noexcept { }
+
+    Reclaimer& reclaimer() const noexcept { return *this->_reclaimer; }
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include "stdafx.h"
+#include "Arena.cpp"
+
+//Binary format of PtrArray::save/load, in native byte order:
+//  header  'PTRA' magic, u32 format version, u64 element count
+//  element u32 type tag (0 for nullptr) followed by the payload written by the type's writer
+
+inline constexpr uint32_t serialization_magic = 0x41525450;
+inline constexpr uint32_t serialization_version = 1;
+
+template<typename Pod>
+    requires std::is_trivially_copyable_v<Pod>
+void binary_write(std::ostream& _Stream, Pod const& _Value)
+{
+    _Stream.write(reinterpret_cast<char const*>(&_Value), sizeof(Pod));
+}
+
+template<typename Pod>
+    requires std::is_trivially_copyable_v<Pod>
+Pod binary_read(std::istream& _Stream)
+{
+    Pod value;
+    if (!_Stream.read(reinterpret_cast<char*>(&value), sizeof(Pod)))
+        throw std::runtime_error("Unexpected end of the stream");
+
+    return value;
+}
+
+//Bytes left in the stream, or the largest size_t when it cannot seek
+inline size_t binary_remaining(std::istream& _Stream)
+{
+    constexpr size_t unknown = std::numeric_limits<size_t>::max();
+
+    std::streampos pos = _Stream.tellg();
+    if (pos == std::streampos(-1))
+        return unknown;
+
+    _Stream.seekg(0, std::ios::end);
+    std::streampos end = _Stream.tellg();
+    _Stream.seekg(pos);
+    if (!_Stream || end == std::streampos(-1))
+    {
+        _Stream.clear();
+        _Stream.seekg(pos);
+        return unknown;
+    }
+
+    return static_cast<size_t>(end - pos);
+}
+
+//Tags, writers and readers of the dynamic types that may be stored behind a T*.
+//A writer stores the payload of a U, a reader reads it back and returns the U by value
+//so the object can be built on the heap or right inside an arena
+template<typename T>
+class TypeRegistry
+{
+public:
+    using writer_type = std::function<void(std::ostream&, T const&)>;
+    using reader_type = std::function<T*(std::istream&, Arena*)>;
+
+private:
+    struct Entry
+    {
+        uint32_t tag;
+        writer_type write;
+    };
+
+    //Fields
+    std::unordered_map<std::type_index, Entry> _by_type;
+    std::unordered_map<uint32_t, reader_type> _by_tag;
+
+public:
+    //Registry used by default
+    static TypeRegistry& instance()
+    {
+        static TypeRegistry registry;
+        return registry;
+    }
+
+    //Tags must be unique and not 0
+    template<std::derived_from<T> U, typename Write, typename Read>
+    void add(uint32_t _Tag, Write _Write, Read _Read)
+    {
+        if (!_Tag || this->_by_tag.contains(_Tag) || this->_by_type.contains(typeid(U)))
+            throw std::invalid_argument("Type or tag is already registered");
+
+        this->_by_tag.emplace(_Tag, [read = std::move(_Read)](std::istream& stream, Arena* arena) -> T*
+        {
+            if (arena)
+                return arena->create<U>(read(stream));
+
+            return new U(read(stream));
+        });
+
+        this->_by_type.emplace(typeid(U), Entry{ _Tag, [write = std::move(_Write)](std::ostream& stream, T const& obj)
+        {
+            write(stream, static_cast<U const&>(obj));
+        } });
+    }
+
+    //Tag and payload of the object
+    void write(std::ostream& _Stream, T const* _Obj) const
+    {
+        if (!_Obj)
+        {
+            binary_write<uint32_t>(_Stream, 0);
+            return;
+        }
+
+        auto it = this->_by_type.find(typeid(*_Obj));
+        if (it == this->_by_type.end())
+            throw std::invalid_argument("Dynamic type of the object is not registered");
+
+        binary_write(_Stream, it->second.tag);
+        it->second.write(_Stream, *_Obj);
+    }
+
+    //Read an object into the arena, or onto the heap if _Arena is nullptr
+    T* read(std::istream& _Stream, Arena* _Arena = nullptr) const
+    {
+        uint32_t tag = binary_read<uint32_t>(_Stream);
+        if (!tag)
+            return nullptr;
+
+        auto it = this->_by_tag.find(tag);
+        if (it == this->_by_tag.end())
+            throw std::runtime_error("Unknown type tag in the stream");
+
+        return it->second(_Stream, _Arena);
+    }
+};
@@ -0,0 +1,293 @@
+#pragma once
+#include "stdafx.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PTRARRAY_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PTRARRAY_SIMD_SSE2
+#endif
+
+//Scans over contiguous columns of keys: counting, searching, sum, min and max.
+//int32_t keys go through AVX2 or SSE2 when the target has them, other arithmetic keys
+//(and targets without SIMD) use plain loops that the compiler is free to vectorize
+
+enum class KeyCompare { equal, not_equal, less, less_equal, greater, greater_equal };
+
+template<KeyCompare Op, typename Key>
+constexpr bool key_compare(Key const& _Lhs, Key const& _Rhs) noexcept
+{
+    if constexpr (Op == KeyCompare::equal) return _Lhs == _Rhs;
+    else if constexpr (Op == KeyCompare::not_equal) return _Lhs != _Rhs;
+    else if constexpr (Op == KeyCompare::less) return _Lhs < _Rhs;
+    else if constexpr (Op == KeyCompare::less_equal) return _Lhs <= _Rhs;
+    else if constexpr (Op == KeyCompare::greater) return _Lhs > _Rhs;
+    else return _Lhs >= _Rhs;
+}
+
+//Call _Fn with the comparison as a std::integral_constant, so every loop is compiled once per operator
+template<typename Fn>
+decltype(auto) _dispatch_Compare(KeyCompare _Op, Fn&& _Fn)
+{
+    using enum KeyCompare;
+    switch (_Op)
+    {
+    case equal: return _Fn(std::integral_constant<KeyCompare, equal>{});
+    case not_equal: return _Fn(std::integral_constant<KeyCompare, not_equal>{});
+    case less: return _Fn(std::integral_constant<KeyCompare, less>{});
+    case less_equal: return _Fn(std::integral_constant<KeyCompare, less_equal>{});
+    case greater: return _Fn(std::integral_constant<KeyCompare, greater>{});
+    default: return _Fn(std::integral_constant<KeyCompare, greater_equal>{});
+    }
+}
+
+#if defined(PTRARRAY_SIMD_AVX2)
+
+//Lanes of 8 int32_t
+struct _simd_I32
+{
+    using vec = __m256i;
+    static constexpr size_t width = 8;
+
+    static vec load(int32_t const* _Ptr) noexcept { return _mm256_loadu_si256(reinterpret_cast<vec const*>(_Ptr)); }
+    static void store(void* _Ptr, vec a) noexcept { _mm256_storeu_si256(static_cast<vec*>(_Ptr), a); }
+    static vec broadcast(int32_t _Value) noexcept { return _mm256_set1_epi32(_Value); }
+    static vec zero() noexcept { return _mm256_setzero_si256(); }
+
+    static vec eq(vec a, vec b) noexcept { return _mm256_cmpeq_epi32(a, b); }
+    static vec gt(vec a, vec b) noexcept { return _mm256_cmpgt_epi32(a, b); }
+    static vec min(vec a, vec b) noexcept { return _mm256_min_epi32(a, b); }
+    static vec max(vec a, vec b) noexcept { return _mm256_max_epi32(a, b); }
+    static vec add64(vec a, vec b) noexcept { return _mm256_add_epi64(a, b); }
+    static vec unpack_lo(vec a, vec b) noexcept { return _mm256_unpacklo_epi32(a, b); }
+    static vec unpack_hi(vec a, vec b) noexcept { return _mm256_unpackhi_epi32(a, b); }
+
+    //One bit per lane whose mask is set
+    static unsigned bits(vec a) noexcept { return unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(a))); }
+};
+
+#elif defined(PTRARRAY_SIMD_SSE2)
+
+//Lanes of 4 int32_t, SSE2 has no min/max of int32_t so they are blended from a comparison
+struct _simd_I32
+{
+    using vec = __m128i;
+    static constexpr size_t width = 4;
+
+    static vec load(int32_t const* _Ptr) noexcept { return _mm_loadu_si128(reinterpret_cast<vec const*>(_Ptr)); }
+    static void store(void* _Ptr, vec a) noexcept { _mm_storeu_si128(static_cast<vec*>(_Ptr), a); }
+    static vec broadcast(int32_t _Value) noexcept { return _mm_set1_epi32(_Value); }
+    static vec zero() noexcept { return _mm_setzero_si128(); }
+
+    static vec eq(vec a, vec b) noexcept { return _mm_cmpeq_epi32(a, b); }
+    static vec gt(vec a, vec b) noexcept { return _mm_cmpgt_epi32(a, b); }
+    static vec select(vec m, vec a, vec b) noexcept { return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b)); }
+    static vec min(vec a, vec b) noexcept { return select(gt(a, b), b, a); }
+    static vec max(vec a, vec b) noexcept { return select(gt(a, b), a, b); }
+    static vec add64(vec a, vec b) noexcept { return _mm_add_epi64(a, b); }
+    static vec unpack_lo(vec a, vec b) noexcept { return _mm_unpacklo_epi32(a, b); }
+    static vec unpack_hi(vec a, vec b) noexcept { return _mm_unpackhi_epi32(a, b); }
+
+    static unsigned bits(vec a) noexcept { return unsigned(_mm_movemask_ps(_mm_castsi128_ps(a))); }
+};
+
+#endif
+
+#if defined(PTRARRAY_SIMD_AVX2) || defined(PTRARRAY_SIMD_SSE2)
+
+//Lanes of x that compare to the key, one bit per lane
+template<KeyCompare Op>
+unsigned _simd_Match(_simd_I32::vec x, _simd_I32::vec key) noexcept
+{
+    using V = _simd_I32;
+    constexpr unsigned all = (1u << V::width) - 1;
+
+    if constexpr (Op == KeyCompare::equal) return V::bits(V::eq(x, key));
+    else if constexpr (Op == KeyCompare::not_equal) return ~V::bits(V::eq(x, key)) & all;
+    else if constexpr (Op == KeyCompare::less) return V::bits(V::gt(key, x));
+    else if constexpr (Op == KeyCompare::less_equal) return ~V::bits(V::gt(x, key)) & all;
+    else if constexpr (Op == KeyCompare::greater) return V::bits(V::gt(x, key));
+    else return ~V::bits(V::gt(key, x)) & all;
+}
+
+template<KeyCompare Op>
+size_t _simd_Count(int32_t const* _First, size_t _Size, int32_t _Key) noexcept
+{
+    using V = _simd_I32;
+    auto key = V::broadcast(_Key);
+
+    size_t count = 0, i = 0;
+    for (; i + V::width <= _Size; i += V::width)
+        count += std::popcount(_simd_Match<Op>(V::load(_First + i), key));
+
+    for (; i < _Size; ++i)
+        count += key_compare<Op>(_First[i], _Key);
+
+    return count;
+}
+
+template<KeyCompare Op>
+size_t _simd_Find(int32_t const* _First, size_t _Size, int32_t _Key) noexcept
+{
+    using V = _simd_I32;
+    auto key = V::broadcast(_Key);
+
+    size_t i = 0;
+    for (; i + V::width <= _Size; i += V::width)
+        if (unsigned match = _simd_Match<Op>(V::load(_First + i), key))
+            return i + std::countr_zero(match);
+
+    for (; i < _Size; ++i)
+        if (key_compare<Op>(_First[i], _Key))
+            return i;
+
+    return _Size;
+}
+
+//Lanes are sign-extended to 64 bits, so the sum does not overflow
+inline int64_t _simd_Sum(int32_t const* _First, size_t _Size) noexcept
+{
+    using V = _simd_I32;
+    auto acc = V::zero();
+
+    size_t i = 0;
+    for (; i + V::width <= _Size; i += V::width)
+    {
+        auto x = V::load(_First + i);
+        auto sign = V::gt(V::zero(), x);
+        acc = V::add64(acc, V::add64(V::unpack_lo(x, sign), V::unpack_hi(x, sign)));
+    }
+
+    int64_t lanes[V::width / 2];
+    V::store(lanes, acc);
+
+    int64_t sum = std::accumulate(std::begin(lanes), std::end(lanes), int64_t(0));
+    for (; i < _Size; ++i)
+        sum += _First[i];
+
+    return sum;
+}
+
+//Smallest (Max = false) or biggest key of a non-empty column
+template<bool Max>
+int32_t _simd_Extreme(int32_t const* _First, size_t _Size) noexcept
+{
+    using V = _simd_I32;
+    if (_Size < V::width)
+        return Max ? *std::max_element(_First, _First + _Size) : *std::min_element(_First, _First + _Size);
+
+    auto acc = V::load(_First);
+    size_t i = V::width;
+    for (; i + V::width <= _Size; i += V::width)
+        acc = Max ? V::max(acc, V::load(_First + i)) : V::min(acc, V::load(_First + i));
+
+    int32_t lanes[V::width];
+    V::store(lanes, acc);
+
+    int32_t result = Max ? *std::max_element(lanes, lanes + V::width) : *std::min_element(lanes, lanes + V::width);
+    for (; i < _Size; ++i)
+        result = Max ? std::max(result, _First[i]) : std::min(result, _First[i]);
+
+    return result;
+}
+
+#endif
+
+//Whether the keys of this type are scanned with SIMD on this target
+template<typename Key>
+inline constexpr bool simd_keys =
+#if defined(PTRARRAY_SIMD_AVX2) || defined(PTRARRAY_SIMD_SSE2)
+    std::is_same_v<Key, int32_t>;
+#else
+    false;
+#endif
+
+//Type the keys are summed up in
+template<typename Key>
+using simd_sum_t = std::conditional_t<std::is_floating_point_v<Key>, double,
+    std::conditional_t<std::is_signed_v<Key>, int64_t, uint64_t>>;
+
+//Number of keys that compare to _Key as 'key op _Key'
+template<typename Key>
+size_t simd_count(std::span<Key const> _Keys, KeyCompare _Op, Key _Key) noexcept
+{
+    return _dispatch_Compare(_Op, [&](auto op) -> size_t
+    {
+#if defined(PTRARRAY_SIMD_AVX2) || defined(PTRARRAY_SIMD_SSE2)
+        if constexpr (simd_keys<Key>)
+            return _simd_Count<decltype(op)::value>(_Keys.data(), _Keys.size(), _Key);
+        else
+#endif
+        {
+            size_t count = 0;
+            for (Key const& key : _Keys)
+                count += key_compare<decltype(op)::value>(key, _Key);
+
+            return count;
+        }
+    });
+}
+
+//Index of the first key that compares to _Key as 'key op _Key', or the size of the column
+template<typename Key>
+size_t simd_find(std::span<Key const> _Keys, KeyCompare _Op, Key _Key) noexcept
+{
+    return _dispatch_Compare(_Op, [&](auto op) -> size_t
+    {
+#if defined(PTRARRAY_SIMD_AVX2) || defined(PTRARRAY_SIMD_SSE2)
+        if constexpr (simd_keys<Key>)
+            return _simd_Find<decltype(op)::value>(_Keys.data(), _Keys.size(), _Key);
+        else
+#endif
+        {
+            for (size_t i = 0; i < _Keys.size(); ++i)
+                if (key_compare<decltype(op)::value>(_Keys[i], _Key))
+                    return i;
+
+            return _Keys.size();
+        }
+    });
+}
+
+template<typename Key>
+simd_sum_t<Key> simd_sum(std::span<Key const> _Keys) noexcept
+{
+#if defined(PTRARRAY_SIMD_AVX2) || defined(PTRARRAY_SIMD_SSE2)
+    if constexpr (simd_keys<Key>)
+        return _simd_Sum(_Keys.data(), _Keys.size());
+    else
+#endif
+        return std::accumulate(_Keys.begin(), _Keys.end(), simd_sum_t<Key>(0));
+}
+
+//Index of the first smallest key, or the size of an empty column.
+//The value is found in one vectorized pass and its position in a second one
+template<typename Key>
+size_t simd_min(std::span<Key const> _Keys) noexcept
+{
+    if (_Keys.empty())
+        return 0;
+
+#if defined(PTRARRAY_SIMD_AVX2) || defined(PTRARRAY_SIMD_SSE2)
+    if constexpr (simd_keys<Key>)
+        return simd_find(_Keys, KeyCompare::equal, _simd_Extreme<false>(_Keys.data(), _Keys.size()));
+    else
+#endif
+        return std::min_element(_Keys.begin(), _Keys.end()) - _Keys.begin();
+}
+
+//Index of the first biggest key, or the size of an empty column
+template<typename Key>
+size_t simd_max(std::span<Key const> _Keys) noexcept
+{
+    if (_Keys.empty())
+        return 0;
+
+#if defined(PTRARRAY_SIMD_AVX2) || defined(PTRARRAY_SIMD_SSE2)
+    if constexpr (simd_keys<Key>)
+        return simd_find(_Keys, KeyCompare::equal, _simd_Extreme<true>(_Keys.data(), _Keys.size()));
+    else
+#endif
+        return std::max_element(_Keys.begin(), _Keys.end()) - _Keys.begin();
+}
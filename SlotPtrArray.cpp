@@ -0,0 +1,203 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+//Slot map over a PtrArray: every element gets a handle that stays valid until the element is erased,
+//whatever happens to the others. Elements are kept packed in a dense PtrArray, so full passes run over it as usual;
+//erasing moves the last element into the hole, so the dense order is not the order of insertion.
+//get(), insert() and erase() are O(1), slots of erased elements are reused through a free list
+//and their generation tells stale handles apart
+template <cloneable T, typename Alloc = HeapAllocator>
+class SlotPtrArray
+{
+public:
+    using array_type = PtrArray<T, Alloc>;
+    using Iterator = typename array_type::Iterator;
+
+    //Reference to an element, the default one refers to nothing
+    struct Handle
+    {
+        uint32_t index = 0;
+        uint32_t generation = 0;
+
+        bool operator==(Handle const& other) const = default;
+    };
+
+private:
+    //Dense index of a live element, or the next free slot while the slot is free
+    struct Slot
+    {
+        uint32_t dense;
+        uint32_t generation;
+    };
+
+    static constexpr uint32_t _npos = uint32_t(-1);
+
+    //Fields
+    array_type _dense;
+    std::vector<uint32_t> _dense_Slots;
+    std::vector<Slot> _slots;
+    uint32_t _free_head = _npos;
+
+    //Private methods
+
+    //Take a slot from the free list or make a new one
+    uint32_t _take_Slot()
+    {
+        uint32_t index = this->_free_head;
+        if (index != _npos)
+            this->_free_head = this->_slots[index].dense;
+        else
+        {
+            index = uint32_t(this->_slots.size());
+            this->_slots.push_back({ _npos, 1 });
+        }
+
+        return index;
+    }
+
+    //Append an element to the dense array through _Append and give it a slot, nothing changes if it throws
+    template<typename Fn>
+    Handle _insert(Fn _Append)
+    {
+        uint32_t index = this->_take_Slot();
+        try
+        {
+            this->_dense_Slots.push_back(index);
+            _Append();
+        }
+        catch (...)
+        {
+            if (this->_dense_Slots.size() > this->_dense.size())
+                this->_dense_Slots.pop_back();
+
+            this->_free_Slot(index);
+            throw;
+        }
+
+        Slot& slot = this->_slots[index];
+        slot.dense = uint32_t(this->_dense.size() - 1);
+
+        return { index, slot.generation };
+    }
+
+    //Invalidate the handles of the slot and put it on the free list
+    void _free_Slot(uint32_t _Index) noexcept
+    {
+        Slot& slot = this->_slots[_Index];
+        if (++slot.generation == 0)
+            slot.generation = 1;
+
+        slot.dense = this->_free_head;
+        this->_free_head = _Index;
+    }
+
+    bool _is_Live(Handle _Handle) const noexcept
+    {
+        return _Handle.index < this->_slots.size() && _Handle.generation
+            && this->_slots[_Handle.index].generation == _Handle.generation;
+    }
+
+public:
+    //Constructors
+    SlotPtrArray() = default;
+
+    explicit SlotPtrArray(Alloc const& _Alloc)
+        : _dense(_Alloc)
+    { }
+
+    //Modifiers
+
+    //Ownership rules of PtrArray: rvalue pointers are adopted, lvalue ones are cloned
+    template<typename U>
+    Handle insert(U&& obj)
+    {
+        return this->_insert([&] { this->_dense.push_back(std::forward<U>(obj)); });
+    }
+
+    template<std::derived_from<T> U, typename... Args>
+    Handle emplace_new(Args&&... args)
+    {
+        return this->_insert([&] { this->_dense.template emplace_back_new<U>(std::forward<Args>(args)...); });
+    }
+
+    //Erase the element, returns false for a stale handle
+    bool erase(Handle _Handle)
+    {
+        if (!this->_is_Live(_Handle))
+            return false;
+
+        uint32_t dense = this->_slots[_Handle.index].dense;
+        uint32_t last = uint32_t(this->_dense.size() - 1);
+        if (dense != last)
+        {
+            //Fill the hole with the last element
+            std::iter_swap(this->_dense.begin() + dense, this->_dense.begin() + last);
+            this->_dense_Slots[dense] = this->_dense_Slots[last];
+            this->_slots[this->_dense_Slots[dense]].dense = dense;
+        }
+
+        this->_dense.pop_back();
+        this->_dense_Slots.pop_back();
+        this->_free_Slot(_Handle.index);
+
+        return true;
+    }
+
+    //Erase everything, all handles become stale
+    void clear()
+    {
+        for (uint32_t index : this->_dense_Slots)
+            this->_free_Slot(index);
+
+        this->_dense.clear();
+        this->_dense_Slots.clear();
+    }
+
+    //Accessors
+
+    //nullptr for stale handles
+    T* get(Handle _Handle) const noexcept
+    {
+        return this->_is_Live(_Handle) ? this->_dense[this->_slots[_Handle.index].dense] : nullptr;
+    }
+
+    bool contains(Handle _Handle) const noexcept
+    {
+        return this->_is_Live(_Handle);
+    }
+
+    //Handle of the element at a dense position
+    Handle handle_at(size_t _Dense) const noexcept
+    {
+        uint32_t index = this->_dense_Slots[_Dense];
+        return { index, this->_slots[index].generation };
+    }
+
+    //Packed elements in an unspecified order
+    array_type const& dense() const noexcept
+    {
+        return this->_dense;
+    }
+
+    //Capacity
+    size_t size() const noexcept
+    {
+        return this->_dense.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return this->_dense.empty();
+    }
+
+    Iterator begin() const
+    {
+        return this->_dense.begin();
+    }
+
+    Iterator end() const
+    {
+        return this->_dense.end();
+    }
+};
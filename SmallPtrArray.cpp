@@ -0,0 +1,314 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+//PtrArray with inline room for N slots: up to N elements live in a buffer inside the object, so small arrays
+//never allocate the slot array. The first insertion past N spills the slots into a regular PtrArray,
+//which keeps them from then on (moving a spilled array is O(1)). Spilling moves the pointers, nothing is cloned.
+//Inline and spilled elements are both reached through PtrArray's Wrapper and Iterator
+template <cloneable T, size_t N, typename Alloc = HeapAllocator, typename Growth = GeometricGrowth<>>
+class SmallPtrArray
+{
+    static_assert(N > 0, "Inline buffer has to hold at least one slot");
+
+public:
+    using array_type = PtrArray<T, Alloc, Growth>;
+    using value_type = typename array_type::value_type;
+    using pointer = typename array_type::pointer;
+    using Iterator = typename array_type::Iterator;
+
+private:
+    //Fields
+    array_type _heap;
+    alignas(value_type) std::byte _buffer[N * sizeof(value_type)];
+    size_t _length = 0;
+    bool _spilled = false;
+
+    //Private methods
+
+    //Inline slots, only [0, _length) hold constructed Wrappers
+    pointer _slots() const noexcept
+    {
+        return std::launder(reinterpret_cast<pointer>(const_cast<std::byte*>(this->_buffer)));
+    }
+
+    //Wrappers are trivially relocatable (see PtrArray), so inline slots are moved around as bytes
+    static void _move_Slots(pointer _First, pointer _Last, pointer _Dest) noexcept
+    {
+        if (_First != _Dest && _First != _Last)
+            std::memmove(static_cast<void*>(_Dest), static_cast<void const*>(_First), (_Last - _First) * sizeof(value_type));
+    }
+
+    //Hand the inline elements over to the heap array, which gets room for at least _Capacity elements
+    void _spill(size_t _Capacity)
+    {
+        pointer slots = this->_slots();
+        this->_heap.reserve(std::max(_Capacity, 2 * N));
+
+        //Slots carry the handle of the heap array's allocator, so the pointers are just moved
+        this->_heap.insert(this->_heap.end(), std::make_move_iterator(slots), std::make_move_iterator(slots + this->_length));
+
+        std::destroy(slots, slots + this->_length);
+        this->_length = 0;
+        this->_spilled = true;
+    }
+
+    //Take over other's elements, other is left empty
+    void _steal(SmallPtrArray& other) noexcept
+    {
+        this->_spilled = std::exchange(other._spilled, false);
+        this->_length = std::exchange(other._length, 0);
+        _move_Slots(other._slots(), other._slots() + this->_length, this->_slots());
+    }
+
+    void _destroy_Inline() noexcept
+    {
+        std::destroy(this->_slots(), this->_slots() + this->_length);
+        this->_length = 0;
+    }
+
+public:
+    //Constructors
+    SmallPtrArray() = default;
+
+    explicit SmallPtrArray(Alloc const& _Alloc, Growth const& _Growth = {})
+        : _heap(_Alloc, _Growth)
+    { }
+
+    SmallPtrArray(SmallPtrArray const& other)
+        : _heap(other._heap), _spilled(other._spilled)
+    {
+        if (!other._spilled)
+            this->insert(this->end(), other.begin(), other.end());
+    }
+
+    SmallPtrArray(SmallPtrArray&& other) noexcept
+        : _heap(std::move(other._heap))
+    {
+        this->_steal(other);
+    }
+
+    template<typename... Args>
+        requires (sizeof...(Args) > 0 && (std::convertible_to<Args, T*> && ...))
+    explicit SmallPtrArray(Args&&... elems)
+    {
+        this->emplace_back(std::forward<Args>(elems)...);
+    }
+
+    //Copy and assignment operators
+    SmallPtrArray& operator=(SmallPtrArray const& other)
+    {
+        if (this != &other)
+            *this = SmallPtrArray(other);
+
+        return *this;
+    }
+
+    SmallPtrArray& operator=(SmallPtrArray&& other) noexcept
+    {
+        if (this != &other)
+        {
+            this->_destroy_Inline();
+            this->_heap = std::move(other._heap);
+            this->_steal(other);
+        }
+
+        return *this;
+    }
+
+    ~SmallPtrArray()
+    {
+        this->_destroy_Inline();
+    }
+
+    //Modifiers
+    template <typename... Args>
+    void emplace(Iterator position, Args&&... elems)
+    {
+        if (this->_spilled)
+            return this->_heap.emplace(position, std::forward<Args>(elems)...);
+
+        size_t index = position - this->begin();
+        size_t count = sizeof...(elems);
+        if (this->_length + count > N)
+        {
+            this->_spill(this->_length + count);
+            return this->_heap.emplace(this->_heap.begin() + index, std::forward<Args>(elems)...);
+        }
+
+        //Shift the tail and fill the gap, as PtrArray does
+        pointer slots = this->_slots();
+        _move_Slots(slots + index, slots + this->_length, slots + index + count);
+        for (size_t i = 0; i < count; ++i)
+            std::construct_at(slots + index + i, this->_heap.get_allocator().handle());
+
+        this->_length += count;
+
+        Iterator it(slots + index);
+        ((*(it++) = std::forward<Args>(elems)), ...);
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... elems)
+    {
+        this->emplace(this->end(), std::forward<Args>(elems)...);
+    }
+
+    template <typename... Args>
+    void emplace_front(Args&&... elems)
+    {
+        this->emplace(this->begin(), std::forward<Args>(elems)...);
+    }
+
+    template<typename U>
+    void push_back(U&& obj)
+    {
+        this->emplace(this->end(), std::forward<U>(obj));
+    }
+
+    template<typename U>
+    void push_front(U&& obj)
+    {
+        this->emplace(this->begin(), std::forward<U>(obj));
+    }
+
+    //Insert a range with PtrArray's ownership rules, spilling once if it does not fit.
+    //Returns an iterator to the first inserted element; if a clone throws, what was inserted is erased again
+    template<std::input_iterator It, std::sentinel_for<It> S>
+    Iterator insert(Iterator position, It first, S last)
+    {
+        size_t start = position - this->begin();
+        size_t index = start;
+
+        try
+        {
+            if (!this->_spilled)
+            {
+                for (; first != last; ++first, ++index)
+                {
+                    if (this->_length == N)
+                    {
+                        this->_spill(N + 1);
+                        break;
+                    }
+
+                    this->emplace(this->begin() + index, *first);
+                }
+            }
+
+            if (this->_spilled)
+                this->_heap.insert(this->_heap.begin() + index, std::move(first), std::move(last));
+        }
+        catch (...)
+        {
+            //The heap array has already dropped its own part, only the elements inserted one by one are left
+            this->erase(this->begin() + start, this->begin() + index);
+            throw;
+        }
+
+        return this->begin() + start;
+    }
+
+    //Erase elements at [_First, _Last)
+    void erase(Iterator _First, Iterator _Last)
+    {
+        if (this->_spilled)
+            return this->_heap.erase(_First, _Last);
+
+        if (_First < this->begin() || _Last > this->end() || _First >= _Last)
+            return;
+
+        pointer slots = this->_slots();
+        pointer first = slots + (_First - this->begin());
+        pointer last = slots + (_Last - this->begin());
+
+        std::destroy(first, last);
+        _move_Slots(last, slots + this->_length, first);
+        this->_length -= last - first;
+    }
+
+    void erase(Iterator position)
+    {
+        this->erase(position, position + 1);
+    }
+
+    void pop_front()
+    {
+        this->erase(this->begin());
+    }
+
+    void pop_back()
+    {
+        this->erase(this->end() - 1);
+    }
+
+    //Destroy the elements, a spilled array keeps its heap memory
+    void clear()
+    {
+        if (this->_spilled) this->_heap.clear();
+        else this->_destroy_Inline();
+    }
+
+    //Capacity
+    size_t size() const noexcept
+    {
+        return this->_spilled ? this->_heap.size() : this->_length;
+    }
+
+    bool empty() const noexcept
+    {
+        return !this->size();
+    }
+
+    size_t capacity() const noexcept
+    {
+        return this->_spilled ? this->_heap.capacity() : N;
+    }
+
+    //Whether the elements still live inside the object
+    bool is_inline() const noexcept
+    {
+        return !this->_spilled;
+    }
+
+    //Spills if more than N slots are asked for
+    void reserve(size_t _new_Capacity)
+    {
+        if (this->_spilled) this->_heap.reserve(_new_Capacity);
+        else if (_new_Capacity > N) this->_spill(_new_Capacity);
+    }
+
+    T const& at(const size_t index) const noexcept(false)
+    {
+        if (index >= this->size())
+            throw std::out_of_range("Index of the array is out of the range");
+
+        return *this->begin()[index];
+    }
+
+    T* operator[](const size_t index) const noexcept
+    {
+        if (this->_spilled)
+            return this->_heap[index];
+
+        if (index >= this->_length)
+            return this->_length ? static_cast<T*>(this->begin()[0]) : nullptr;
+
+        return this->begin()[index];
+    }
+
+    Alloc const& get_allocator() const noexcept
+    {
+        return this->_heap.get_allocator();
+    }
+
+    Iterator begin() const
+    {
+        return this->_spilled ? this->_heap.begin() : Iterator(this->_slots());
+    }
+
+    Iterator end() const
+    {
+        return this->_spilled ? this->_heap.end() : Iterator(this->_slots() + this->_length);
+    }
+};
@@ -0,0 +1,241 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+//PtrArray of at most N elements whose slots live in a std::array inside the object, the container itself never allocates.
+//Insertions past N fail: the try_ versions return false, the others throw std::length_error; in both cases nothing is
+//inserted and rvalue pointers stay with the caller. Slots are PtrArray's Wrappers, so the ownership rules are the same.
+//Everything is constexpr, so with constexpr clone() the array can be built and queried inside constant evaluation.
+//Pointees are heap objects, and C++ does not let those outlive the evaluation that made them, so a table meant
+//for runtime has to be built at runtime (e.g. as a static) and then cloned from
+template <cloneable T, size_t N>
+class StaticPtrArray
+{
+public:
+    using array_type = PtrArray<T>;
+    using value_type = typename array_type::value_type;
+    using pointer = typename array_type::pointer;
+    using Iterator = typename array_type::Iterator;
+
+private:
+    //Fields
+    //Slots at [_length, N) are empty Wrappers
+    std::array<value_type, N> _slots;
+    size_t _length = 0;
+
+    //Private methods
+
+    //Move the elements at [_Index, _length) _Count slots to the right, the slots before them come back empty
+    constexpr void _make_Gap(size_t _Index, size_t _Count) noexcept
+    {
+        std::move_backward(this->_slots.begin() + _Index, this->_slots.begin() + this->_length,
+            this->_slots.begin() + this->_length + _Count);
+    }
+
+    constexpr pointer _data() const noexcept
+    {
+        return const_cast<pointer>(this->_slots.data());
+    }
+
+public:
+    //Constructors
+    constexpr StaticPtrArray() = default;
+
+    constexpr StaticPtrArray(StaticPtrArray const& other)
+    {
+        *this = other;
+    }
+
+    constexpr StaticPtrArray(StaticPtrArray&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    template<typename... Args>
+        requires (sizeof...(Args) > 0 && (std::convertible_to<Args, T*> && ...))
+    constexpr explicit StaticPtrArray(Args&&... elems)
+    {
+        static_assert(sizeof...(Args) <= N, "Too many elements for the array");
+        this->emplace_back(std::forward<Args>(elems)...);
+    }
+
+    //Copy and assignment operators
+    //Only the used slots are assigned, copies clone the elements
+    constexpr StaticPtrArray& operator=(StaticPtrArray const& other)
+    {
+        if (this != &other)
+        {
+            this->clear();
+            std::copy(other._slots.begin(), other._slots.begin() + other._length, this->_slots.begin());
+            this->_length = other._length;
+        }
+
+        return *this;
+    }
+
+    constexpr StaticPtrArray& operator=(StaticPtrArray&& other) noexcept
+    {
+        if (this != &other)
+        {
+            this->clear();
+            std::move(other._slots.begin(), other._slots.begin() + other._length, this->_slots.begin());
+            this->_length = std::exchange(other._length, 0);
+        }
+
+        return *this;
+    }
+
+    //Modifiers
+    template <typename... Args>
+    constexpr bool try_emplace(Iterator position, Args&&... elems)
+    {
+        if (this->_length + sizeof...(elems) > N)
+            return false;
+
+        size_t index = position - this->begin();
+        this->_make_Gap(index, sizeof...(elems));
+        this->_length += sizeof...(elems);
+
+        Iterator it = this->begin() + index;
+        ((*(it++) = std::forward<Args>(elems)), ...);
+        return true;
+    }
+
+    template <typename... Args>
+    constexpr void emplace(Iterator position, Args&&... elems)
+    {
+        if (!this->try_emplace(position, std::forward<Args>(elems)...))
+            throw std::length_error("Static array is full");
+    }
+
+    template <typename... Args>
+    constexpr void emplace_back(Args&&... elems)
+    {
+        this->emplace(this->end(), std::forward<Args>(elems)...);
+    }
+
+    template <typename... Args>
+    constexpr void emplace_front(Args&&... elems)
+    {
+        this->emplace(this->begin(), std::forward<Args>(elems)...);
+    }
+
+    //Construct a new U right at the position
+    template <std::derived_from<T> U, typename... Args>
+    constexpr void emplace_new(Iterator position, Args&&... args)
+    {
+        if (this->full())
+            throw std::length_error("Static array is full");
+
+        this->emplace(position, static_cast<T*>(HeapAllocator::make<U>(std::forward<Args>(args)...)));
+    }
+
+    template <std::derived_from<T> U, typename... Args>
+    constexpr void emplace_back_new(Args&&... args)
+    {
+        this->emplace_new<U>(this->end(), std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    constexpr bool try_push_back(U&& obj)
+    {
+        return this->try_emplace(this->end(), std::forward<U>(obj));
+    }
+
+    template<typename U>
+    constexpr void push_back(U&& obj)
+    {
+        this->emplace(this->end(), std::forward<U>(obj));
+    }
+
+    template<typename U>
+    constexpr void push_front(U&& obj)
+    {
+        this->emplace(this->begin(), std::forward<U>(obj));
+    }
+
+    //Erase elements at [_First, _Last)
+    constexpr void erase(Iterator _First, Iterator _Last)
+    {
+        if (_First < this->begin() || _Last > this->end() || _First >= _Last)
+            return;
+
+        auto first = this->_slots.begin() + (_First - this->begin());
+        auto last = this->_slots.begin() + (_Last - this->begin());
+        auto end = this->_slots.begin() + this->_length;
+
+        //Moving the tail over the erased elements destroys them, the vacated slots are emptied
+        auto new_End = std::move(last, end, first);
+        for (; new_End != end; ++new_End)
+            *new_End = static_cast<T*>(nullptr);
+
+        this->_length -= _Last - _First;
+    }
+
+    constexpr void erase(Iterator position)
+    {
+        this->erase(position, position + 1);
+    }
+
+    constexpr void pop_front()
+    {
+        this->erase(this->begin());
+    }
+
+    constexpr void pop_back()
+    {
+        this->erase(this->end() - 1);
+    }
+
+    constexpr void clear() noexcept
+    {
+        this->erase(this->begin(), this->end());
+    }
+
+    //Capacity
+    constexpr size_t size() const noexcept
+    {
+        return this->_length;
+    }
+
+    static constexpr size_t capacity() noexcept
+    {
+        return N;
+    }
+
+    constexpr bool empty() const noexcept
+    {
+        return !this->_length;
+    }
+
+    constexpr bool full() const noexcept
+    {
+        return this->_length == N;
+    }
+
+    constexpr T const& at(const size_t index) const noexcept(false)
+    {
+        if (index >= this->_length)
+            throw std::out_of_range("Index of the array is out of the range");
+
+        return *this->_slots[index];
+    }
+
+    constexpr T* operator[](const size_t index) const noexcept
+    {
+        if (index >= this->_length)
+            return this->_length ? static_cast<T*>(this->_slots[0]) : nullptr;
+
+        return this->_slots[index];
+    }
+
+    constexpr Iterator begin() const
+    {
+        return Iterator(this->_data());
+    }
+
+    constexpr Iterator end() const
+    {
+        return Iterator(this->_data() + this->_length);
+    }
+};
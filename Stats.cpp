@@ -0,0 +1,214 @@
+#pragma once
+#include "stdafx.h"
+
+//Stats policies of PtrArray count what the array does to its storage and its pointees.
+//A policy wraps the element handle of the allocator, so the events of every Wrapper bound to the array
+//(clones made by its assignments included) are attributed to it, and gets told about the slot storage by the array
+
+//Snapshot of the counters, snapshots of several arrays can be summed up
+struct PtrArrayStats
+{
+    uint64_t clones = 0;           //Pointees made by clone()
+    uint64_t constructed = 0;      //Pointees constructed in place (emplace_new)
+    uint64_t adopted = 0;          //Pointers handed over to the array
+    uint64_t destroyed = 0;        //Pointees destroyed
+    uint64_t allocations = 0;      //Slot storage allocated from scratch
+    uint64_t reallocations = 0;    //Slot storage resized
+    uint64_t bytes_allocated = 0;  //Bytes of slot storage requested by both
+    uint64_t moved = 0;            //Slots shifted by emplace, erase and relocation
+    uint64_t peak_capacity = 0;
+
+    //Counts add up, the peak capacity is the biggest one
+    PtrArrayStats& operator+=(PtrArrayStats const& other) noexcept
+    {
+        this->clones += other.clones;
+        this->constructed += other.constructed;
+        this->adopted += other.adopted;
+        this->destroyed += other.destroyed;
+        this->allocations += other.allocations;
+        this->reallocations += other.reallocations;
+        this->bytes_allocated += other.bytes_allocated;
+        this->moved += other.moved;
+        this->peak_capacity = std::max(this->peak_capacity, other.peak_capacity);
+        return *this;
+    }
+
+    friend PtrArrayStats operator+(PtrArrayStats lhs, PtrArrayStats const& rhs) noexcept
+    {
+        return lhs += rhs;
+    }
+
+    bool operator==(PtrArrayStats const&) const = default;
+};
+
+//Default policy: the handle is used as is and every hook is empty, so nothing is counted and nothing is paid
+struct NoStats
+{
+    template<typename Handle>
+    using handle_type = Handle;
+
+    template<typename Handle>
+    static Handle bind(Handle _Handle) noexcept { return _Handle; }
+
+    void allocated(size_t, size_t) noexcept { }
+    void reallocated(size_t, size_t) noexcept { }
+    void moved(size_t) noexcept { }
+
+    PtrArrayStats snapshot() const noexcept { return {}; }
+};
+
+//Policy that counts every event with relaxed atomics, so elements cloned concurrently (clone_from) are counted too
+class CountingStats
+{
+public:
+    struct Counters
+    {
+        std::atomic<uint64_t> clones = 0;
+        std::atomic<uint64_t> constructed = 0;
+        std::atomic<uint64_t> adopted = 0;
+        std::atomic<uint64_t> destroyed = 0;
+        std::atomic<uint64_t> allocations = 0;
+        std::atomic<uint64_t> reallocations = 0;
+        std::atomic<uint64_t> bytes_allocated = 0;
+        std::atomic<uint64_t> moved = 0;
+        std::atomic<uint64_t> peak_capacity = 0;
+    };
+
+    //Allocator handle that reports to the counters, nullptr stands for a detached Wrapper that counts nothing
+    template<typename Handle>
+    struct handle_type : Handle
+    {
+        Counters* counters = nullptr;
+
+        template<typename U>
+        U* clone(U const& obj) const
+        {
+            U* ptr = Handle::clone(obj);
+            _count(this->counters, &Counters::clones);
+            return ptr;
+        }
+
+        template<typename U, typename... Args>
+        U* make(Args&&... args) const
+        {
+            U* ptr = Handle::template make<U>(std::forward<Args>(args)...);
+            _count(this->counters, &Counters::constructed);
+            return ptr;
+        }
+
+        template<typename U>
+        U* adopt(U* ptr) const
+        {
+            if (ptr)
+                _count(this->counters, &Counters::adopted);
+
+            return Handle::adopt(ptr);
+        }
+
+        template<typename U>
+        void destroy(U* ptr) const noexcept
+        {
+            if (ptr)
+                _count(this->counters, &Counters::destroyed);
+
+            Handle::destroy(ptr);
+        }
+
+        bool same(handle_type const& other) const noexcept
+        {
+            return Handle::same(static_cast<Handle const&>(other));
+        }
+    };
+
+private:
+    //Counters are kept on the heap so the handles stay valid when the array is moved
+    std::unique_ptr<Counters> _counters;
+
+    static void _count(Counters* _Counters, std::atomic<uint64_t> Counters::* _Field, uint64_t _Value = 1) noexcept
+    {
+        if (_Counters)
+            (_Counters->*_Field).fetch_add(_Value, std::memory_order_relaxed);
+    }
+
+    void _storage(std::atomic<uint64_t> Counters::* _Field, size_t _Capacity, size_t _Bytes) noexcept
+    {
+        if (!this->_counters)
+            return;
+
+        _count(this->_counters.get(), _Field);
+        _count(this->_counters.get(), &Counters::bytes_allocated, _Bytes);
+
+        //Only the owning array resizes its storage, so there is no race between the load and the store
+        if (_Capacity > this->_counters->peak_capacity.load(std::memory_order_relaxed))
+            this->_counters->peak_capacity.store(_Capacity, std::memory_order_relaxed);
+    }
+
+public:
+    //Constructors
+    CountingStats()
+        : _counters(std::make_unique<Counters>())
+    { }
+
+    //Copies start counting from zero
+    CountingStats(CountingStats const&)
+        : CountingStats()
+    { }
+
+    //Moved-from arrays stop counting
+    CountingStats(CountingStats&&) noexcept = default;
+
+    //Assignment keeps the own counters
+    CountingStats& operator=(CountingStats const&) noexcept { return *this; }
+    CountingStats& operator=(CountingStats&&) noexcept = default;
+
+    template<typename Handle>
+    handle_type<Handle> bind(Handle _Handle) const noexcept
+    {
+        return { _Handle, this->_counters.get() };
+    }
+
+    void allocated(size_t _Capacity, size_t _Bytes) noexcept
+    {
+        this->_storage(&Counters::allocations, _Capacity, _Bytes);
+    }
+
+    void reallocated(size_t _Capacity, size_t _Bytes) noexcept
+    {
+        this->_storage(&Counters::reallocations, _Capacity, _Bytes);
+    }
+
+    void moved(size_t _Count) noexcept
+    {
+        _count(this->_counters.get(), &Counters::moved, _Count);
+    }
+
+    PtrArrayStats snapshot() const noexcept
+    {
+        if (!this->_counters)
+            return {};
+
+        auto& c = *this->_counters;
+        return {
+            c.clones.load(std::memory_order_relaxed),
+            c.constructed.load(std::memory_order_relaxed),
+            c.adopted.load(std::memory_order_relaxed),
+            c.destroyed.load(std::memory_order_relaxed),
+            c.allocations.load(std::memory_order_relaxed),
+            c.reallocations.load(std::memory_order_relaxed),
+            c.bytes_allocated.load(std::memory_order_relaxed),
+            c.moved.load(std::memory_order_relaxed),
+            c.peak_capacity.load(std::memory_order_relaxed)
+        };
+    }
+
+    //Start counting from zero
+    void reset() noexcept
+    {
+        if (!this->_counters)
+            return;
+
+        for (auto field : { &Counters::clones, &Counters::constructed, &Counters::adopted, &Counters::destroyed,
+            &Counters::allocations, &Counters::reallocations, &Counters::bytes_allocated, &Counters::moved, &Counters::peak_capacity })
+            (this->_counters.get()->*field).store(0, std::memory_order_relaxed);
+    }
+};
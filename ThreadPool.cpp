@@ -0,0 +1,226 @@
+#pragma once
+#include "stdafx.h"
+
+//Work-stealing thread pool.
+//Every worker owns a deque: it pushes and pops its own tasks at the back (LIFO, cache-warm),
+//idle workers steal from the front of the others' deques
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+private:
+    //Deque of one worker
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    //Fields
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::mutex _sleep_mutex;
+    std::condition_variable _wake;
+    std::atomic<std::ptrdiff_t> _pending = 0;
+    std::atomic<size_t> _next_Queue = 0;
+    std::atomic<bool> _stop = false;
+
+    //Worker the current thread belongs to
+    static inline thread_local ThreadPool* _current_pool = nullptr;
+    static inline thread_local size_t _current_index = 0;
+
+    //Private methods
+
+    bool _pop_Back(size_t _Index, Task& _Task)
+    {
+        auto& queue = *this->_queues[_Index];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+
+        _Task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool _steal_Front(size_t _Index, Task& _Task)
+    {
+        auto& queue = *this->_queues[_Index];
+        std::unique_lock lock(queue.mutex, std::try_to_lock);
+        if (!lock || queue.tasks.empty())
+            return false;
+
+        _Task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    //Take a task from the own deque or steal one, starting the search at _Home
+    bool _try_Take(size_t _Home, Task& _Task)
+    {
+        if (this->_pop_Back(_Home, _Task))
+            return true;
+
+        for (size_t i = 1; i < this->_queues.size(); ++i)
+            if (this->_steal_Front((_Home + i) % this->_queues.size(), _Task))
+                return true;
+
+        return false;
+    }
+
+    void _worker_Loop(size_t _Index)
+    {
+        _current_pool = this;
+        _current_index = _Index;
+
+        Task task;
+        while (!this->_stop.load(std::memory_order_relaxed))
+        {
+            if (this->_try_Take(_Index, task))
+            {
+                this->_pending.fetch_sub(1, std::memory_order_relaxed);
+                task();
+                continue;
+            }
+
+            std::unique_lock lock(this->_sleep_mutex);
+            this->_wake.wait(lock, [this] { return this->_stop || this->_pending > 0; });
+        }
+    }
+
+public:
+    //Constructors
+    explicit ThreadPool(size_t _Threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        _Threads = std::max<size_t>(_Threads, 1);
+
+        for (size_t i = 0; i < _Threads; ++i)
+            this->_queues.push_back(std::make_unique<Queue>());
+
+        for (size_t i = 0; i < _Threads; ++i)
+            this->_threads.emplace_back(&ThreadPool::_worker_Loop, this, i);
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    //Tasks that have not started are dropped
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(this->_sleep_mutex);
+            this->_stop = true;
+        }
+        this->_wake.notify_all();
+
+        for (auto& thread : this->_threads)
+            thread.join();
+    }
+
+    //Pool shared by the parallel algorithms by default
+    static ThreadPool& instance()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const noexcept
+    {
+        return this->_threads.size();
+    }
+
+    //Tasks submitted from a worker go to its own deque, others are spread round-robin
+    void submit(Task _Task)
+    {
+        size_t index = _current_pool == this
+            ? _current_index
+            : this->_next_Queue.fetch_add(1, std::memory_order_relaxed) % this->_queues.size();
+
+        {
+            auto& queue = *this->_queues[index];
+            std::lock_guard lock(queue.mutex);
+            queue.tasks.push_back(std::move(_Task));
+        }
+
+        {
+            std::lock_guard lock(this->_sleep_mutex);
+            this->_pending.fetch_add(1, std::memory_order_relaxed);
+        }
+        this->_wake.notify_one();
+    }
+
+    //Run one pending task on the calling thread, returns false if there was nothing to do.
+    //Lets threads that wait for their tasks help instead of blocking
+    bool run_pending()
+    {
+        Task task;
+        size_t home = _current_pool == this ? _current_index : 0;
+        if (!this->_try_Take(home, task))
+            return false;
+
+        this->_pending.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+};
+
+//Set of tasks that can be waited for together.
+//The waiting thread executes pending tasks itself, so groups may be nested inside tasks
+class TaskGroup
+{
+private:
+    //Fields
+    ThreadPool& _pool;
+    std::atomic<size_t> _active = 0;
+    std::mutex _error_mutex;
+    std::exception_ptr _error;
+
+public:
+    //Constructors
+    explicit TaskGroup(ThreadPool& _Pool) noexcept
+        : _pool(_Pool)
+    { }
+
+    TaskGroup(TaskGroup const&) = delete;
+    TaskGroup& operator=(TaskGroup const&) = delete;
+
+    ~TaskGroup()
+    {
+        while (this->_active.load(std::memory_order_acquire))
+            if (!this->_pool.run_pending())
+                std::this_thread::yield();
+    }
+
+    template<typename Fn>
+    void run(Fn _Fn)
+    {
+        this->_active.fetch_add(1, std::memory_order_relaxed);
+        this->_pool.submit([this, fn = std::move(_Fn)]() mutable
+        {
+            try
+            {
+                fn();
+            }
+            catch (...)
+            {
+                std::lock_guard lock(this->_error_mutex);
+                if (!this->_error)
+                    this->_error = std::current_exception();
+            }
+
+            this->_active.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    //Wait for all the tasks and rethrow the first exception one of them has thrown
+    void wait()
+    {
+        while (this->_active.load(std::memory_order_acquire))
+            if (!this->_pool.run_pending())
+                std::this_thread::yield();
+
+        if (this->_error)
+            std::rethrow_exception(std::exchange(this->_error, nullptr));
+    }
+};
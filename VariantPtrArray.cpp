@@ -0,0 +1,305 @@
+#pragma once
+#include "stdafx.h"
+#include "PtrArray.cpp"
+
+//Array over a closed set of concrete types: every element is a std::variant<Us...> stored by value
+//in one contiguous buffer, in the order of insertion.
+//There is no allocation per element and no clone(): copies are plain copy construction of the variants,
+//and visit/for_each call fn with the static type of the element so per-type code can be inlined.
+//The interface follows PtrArray (pointers in, T* out), so call sites only swap the type
+template <cloneable T, std::derived_from<T>... Us>
+    requires (sizeof...(Us) > 0)
+class VariantPtrArray
+{
+public:
+    class Iterator;
+
+    //Aliases
+    using variant_type = std::variant<Us...>;
+    using value_type = T*;
+
+private:
+    //Fields
+    std::vector<variant_type> _elems;
+
+    //Private methods
+
+    //Base pointer of the alternative held by the variant
+    static T* _get_Base(variant_type& _Elem) noexcept
+    {
+        return std::visit([](auto& elem) -> T* { return &elem; }, _Elem);
+    }
+
+    //Copy or move the object into a variant of its dynamic type, which has to be one of Us
+    template<typename Obj>
+    static variant_type _make_Element(Obj&& _Obj)
+    {
+        std::optional<variant_type> made;
+        ((typeid(_Obj) == typeid(Us) && (made.emplace(std::in_place_type<Us>,
+            static_cast<std::conditional_t<std::is_lvalue_reference_v<Obj>, Us const&, Us&&>>(_Obj)), true)) || ...);
+
+        if (!made)
+            throw std::invalid_argument("Dynamic type of the object is not one of the array's types");
+
+        return std::move(*made);
+    }
+
+    //Ownership rules of PtrArray: rvalue pointers are consumed, lvalue ones are copied.
+    //Rvalues are owned before any element is made, so a bad argument can not leak the ones after it
+    template<typename Elem>
+    static auto _take_Element(Elem&& _Elem) noexcept
+    {
+        if constexpr (std::is_rvalue_reference_v<Elem&&>) return std::unique_ptr<T>(static_cast<T*>(_Elem));
+        else return static_cast<T const*>(_Elem);
+    }
+
+    static variant_type _store_Element(std::unique_ptr<T>& _Owned)
+    {
+        if (!_Owned)
+            throw std::invalid_argument("Null pointers cannot be stored by value");
+
+        return _make_Element(std::move(*_Owned));
+    }
+
+    static variant_type _store_Element(T const* _Ptr)
+    {
+        if (!_Ptr)
+            throw std::invalid_argument("Null pointers cannot be stored by value");
+
+        return _make_Element(*_Ptr);
+    }
+
+public:
+    //Random-access iterator, dereferencing gives the element as T*
+    class Iterator
+    {
+    private:
+        friend class VariantPtrArray;
+
+        variant_type* m_ptr;
+
+    public:
+        //Aliases for std library algorithms
+        using iterator_concept = std::random_access_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T*;
+        using reference = T*;
+
+        //Constructors
+        Iterator() : m_ptr(nullptr) { }
+
+        explicit Iterator(variant_type* m_ptr) : m_ptr(m_ptr) { }
+
+        //Accessors
+        reference operator*() const { return _get_Base(*m_ptr); }
+        reference operator->() const { return **this; }
+
+        reference operator[](difference_type ind) const { return _get_Base(m_ptr[ind]); }
+
+        //Arithmetic
+        Iterator& operator++() { ++m_ptr; return *this; }
+        Iterator& operator--() { --m_ptr; return *this; }
+
+        Iterator operator++(int) { auto temp = *this; ++m_ptr; return temp; }
+        Iterator operator--(int) { auto temp = *this; --m_ptr; return temp; }
+
+        Iterator operator+(difference_type n) const { return Iterator(m_ptr + n); }
+        Iterator operator-(difference_type n) const { return Iterator(m_ptr - n); }
+
+        Iterator& operator+=(difference_type n) { m_ptr += n; return *this; }
+        Iterator& operator-=(difference_type n) { m_ptr -= n; return *this; }
+
+        friend Iterator operator+(difference_type n, Iterator other) { return other + n; }
+        difference_type operator-(Iterator const& rhs) const { return m_ptr - rhs.m_ptr; }
+
+        //Comparison
+        std::strong_ordering operator<=>(Iterator const& rhs) const = default;
+    };
+
+    //Constructors
+    VariantPtrArray() = default;
+    VariantPtrArray(VariantPtrArray const& other) = default;
+    VariantPtrArray(VariantPtrArray&& other) noexcept = default;
+
+    template<typename... Args>
+        requires (sizeof...(Args) > 0 && (std::convertible_to<Args, T*> && ...))
+    explicit VariantPtrArray(Args&&... elems)
+    {
+        this->emplace_back(std::forward<Args>(elems)...);
+    }
+
+    //Copy and assignment operators
+    VariantPtrArray& operator=(VariantPtrArray const& other) = default;
+    VariantPtrArray& operator=(VariantPtrArray&& other) noexcept = default;
+
+    //Modifiers
+
+    //Nothing is inserted if one of the elements can not be stored, the rvalue pointers are deleted then all the same
+    template <typename... Args>
+    void emplace(Iterator position, Args&&... elems)
+    {
+        using made_type = std::array<variant_type, sizeof...(elems)>;
+
+        size_t index = position - this->begin();
+        auto taken = std::make_tuple(_take_Element(std::forward<Args>(elems))...);
+        made_type made = std::apply([](auto&... elem) { return made_type{ _store_Element(elem)... }; }, taken);
+
+        this->_elems.insert(this->_elems.begin() + index,
+            std::make_move_iterator(made.begin()), std::make_move_iterator(made.end()));
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... elems)
+    {
+        this->emplace(this->end(), std::forward<Args>(elems)...);
+    }
+
+    template <typename... Args>
+    void emplace_front(Args&&... elems)
+    {
+        this->emplace(this->begin(), std::forward<Args>(elems)...);
+    }
+
+    //Construct a U right at the position
+    template <typename U, typename... Args>
+        requires (std::is_same_v<U, Us> || ...)
+    U& emplace_new(Iterator position, Args&&... args)
+    {
+        auto it = this->_elems.emplace(this->_elems.begin() + (position - this->begin()),
+            std::in_place_type<U>, std::forward<Args>(args)...);
+
+        return std::get<U>(*it);
+    }
+
+    template <typename U, typename... Args>
+        requires (std::is_same_v<U, Us> || ...)
+    U& emplace_back_new(Args&&... args)
+    {
+        return std::get<U>(this->_elems.emplace_back(std::in_place_type<U>, std::forward<Args>(args)...));
+    }
+
+    template<typename U>
+    void push_back(U&& obj)
+    {
+        this->emplace(this->end(), std::forward<U>(obj));
+    }
+
+    template<typename U>
+    void push_front(U&& obj)
+    {
+        this->emplace(this->begin(), std::forward<U>(obj));
+    }
+
+    //Erase elements at [_First, _Last)
+    void erase(Iterator _First, Iterator _Last)
+    {
+        if (_First < this->begin() || _Last > this->end() || _First >= _Last)
+            return;
+
+        this->_elems.erase(this->_elems.begin() + (_First - this->begin()), this->_elems.begin() + (_Last - this->begin()));
+    }
+
+    void erase(Iterator position)
+    {
+        this->erase(position, position + 1);
+    }
+
+    void pop_front()
+    {
+        this->erase(this->begin());
+    }
+
+    void pop_back()
+    {
+        this->erase(this->end() - 1);
+    }
+
+    //Erase the elements the predicate (called with 'T const*') holds for, returns the number of erased elements
+    template<typename Pred>
+    size_t erase_if(Pred pred)
+    {
+        return std::erase_if(this->_elems, [&pred](variant_type& elem) {
+            return std::invoke(pred, static_cast<T const*>(_get_Base(elem))); });
+    }
+
+    void clear() noexcept
+    {
+        this->_elems.clear();
+    }
+
+    //Visitation
+
+    //Call fn with the element at the index as its concrete type
+    template<typename Fn>
+    decltype(auto) visit(size_t _Index, Fn&& fn) const
+    {
+        return std::visit(std::forward<Fn>(fn), this->_elems.at(_Index));
+    }
+
+    //Call fn with every element as its concrete type, in order
+    template<typename Fn>
+    void for_each(Fn fn) const
+    {
+        for (auto const& elem : this->_elems)
+            std::visit(fn, elem);
+    }
+
+    //The variants themselves, for algorithms that want to switch on the type
+    std::span<variant_type const> variants() const noexcept
+    {
+        return this->_elems;
+    }
+
+    //Capacity
+    size_t size() const noexcept
+    {
+        return this->_elems.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return this->_elems.empty();
+    }
+
+    size_t capacity() const noexcept
+    {
+        return this->_elems.capacity();
+    }
+
+    void reserve(size_t _new_Capacity)
+    {
+        this->_elems.reserve(_new_Capacity);
+    }
+
+    void shrink_to_fit()
+    {
+        this->_elems.shrink_to_fit();
+    }
+
+    T const& at(const size_t index) const noexcept(false)
+    {
+        if (index >= this->size())
+            throw std::out_of_range("Index of the array is out of the range");
+
+        return *(*this)[index];
+    }
+
+    T* operator[](const size_t index) const noexcept
+    {
+        if (index >= this->size())
+            return this->empty() ? nullptr : this->begin()[0];
+
+        return this->begin()[index];
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(const_cast<variant_type*>(this->_elems.data()));
+    }
+
+    Iterator end() const
+    {
+        return Iterator(const_cast<variant_type*>(this->_elems.data() + this->_elems.size()));
+    }
+};
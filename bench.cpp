@@ -0,0 +1,398 @@
+//Benchmarks of PtrArray<Base> against std::vector<std::unique_ptr<Base>>, a separate program from main.cpp.
+//Prints one JSON array with a record per (case, container, size):
+//  ns_per_op, allocs_per_op, peak_heap_bytes (live heap at the peak of the case, -1 where it is not tracked)
+//  and peak_rss_kib (peak of the whole process so far, sizes run in increasing order).
+//Linux: g++ -std=c++23 -O2 -DNDEBUG bench.cpp -o bench -pthread -ltbb
+//Options: --max-size N (default 10^6), --min-time-ms N (default 100), --case NAME (run only that case)
+#include "stdafx.h"
+#include "Base.cpp"
+#include "PtrArray.cpp"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+//Allocation counters
+
+static std::atomic<size_t> _allocations = 0;
+static std::atomic<ptrdiff_t> _live_bytes = 0;
+static std::atomic<ptrdiff_t> _peak_bytes = 0;
+
+static void _count_Alloc(ptrdiff_t _Bytes) noexcept
+{
+    _allocations.fetch_add(1, std::memory_order_relaxed);
+
+    ptrdiff_t live = _live_bytes.fetch_add(_Bytes, std::memory_order_relaxed) + _Bytes;
+    ptrdiff_t peak = _peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !_peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+}
+
+#if defined(__GLIBC__)
+//glibc lets the program replace malloc, so the realloc'ed slot buffer of PtrArray is counted as well
+static constexpr bool _tracks_bytes = true;
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void __libc_free(void*);
+
+    void* malloc(size_t size)
+    {
+        void* ptr = __libc_malloc(size);
+        if (ptr) _count_Alloc(malloc_usable_size(ptr));
+        return ptr;
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        void* ptr = __libc_calloc(count, size);
+        if (ptr) _count_Alloc(malloc_usable_size(ptr));
+        return ptr;
+    }
+
+    void* realloc(void* old, size_t size)
+    {
+        ptrdiff_t old_size = old ? malloc_usable_size(old) : 0;
+        void* ptr = __libc_realloc(old, size);
+        if (ptr)
+        {
+            _live_bytes.fetch_sub(old_size, std::memory_order_relaxed);
+            _count_Alloc(malloc_usable_size(ptr));
+        }
+        return ptr;
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size)
+    {
+        void* ptr = __libc_memalign(alignment, size);
+        if (ptr) _count_Alloc(malloc_usable_size(ptr));
+        return ptr;
+    }
+
+    void free(void* ptr)
+    {
+        if (ptr) _live_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+        __libc_free(ptr);
+    }
+}
+#else
+//Elsewhere only operator new is counted, PtrArray's realloc of the slot buffer is not
+static constexpr bool _tracks_bytes = false;
+
+void* operator new(size_t size)
+{
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+
+    _count_Alloc(0);
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+#endif
+
+static size_t _peak_Rss_kib()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize >> 10;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return size_t(usage.ru_maxrss);
+#endif
+}
+
+//Containers under test
+
+//Objects alternate between the derived types, values are a shuffled 0..n-1
+static std::vector<int> _shuffled_Values(size_t _Size)
+{
+    std::vector<int> values(_Size);
+    std::iota(values.begin(), values.end(), 0);
+    std::shuffle(values.begin(), values.end(), std::mt19937(42));
+
+    return values;
+}
+
+static Base* _make_Object(int _Value)
+{
+    if (_Value & 1)
+        return new Derived1(_Value);
+
+    return new Derived2(_Value);
+}
+
+struct PtrArrayBench
+{
+    using container = PtrArray<Base>;
+    static constexpr char const* name = "PtrArray";
+
+    static void push(container& c, Base* obj) { c.emplace_back(std::move(obj)); }
+    static void insert(container& c, size_t index, Base* obj) { c.emplace(c.begin() + index, std::move(obj)); }
+    static void erase(container& c, size_t index) { c.erase(c.begin() + index); }
+    static Base const* get(container const& c, size_t index) { return c[index]; }
+};
+
+struct VectorBench
+{
+    using container = std::vector<std::unique_ptr<Base>>;
+    static constexpr char const* name = "vector<unique_ptr>";
+
+    static void push(container& c, Base* obj) { c.emplace_back(obj); }
+    static void insert(container& c, size_t index, Base* obj) { c.emplace(c.begin() + index, obj); }
+    static void erase(container& c, size_t index) { c.erase(c.begin() + index); }
+    static Base const* get(container const& c, size_t index) { return c[index].get(); }
+
+    //Deep copy, as the copy constructor of PtrArray does
+    static container copy(container const& c)
+    {
+        container result;
+        result.reserve(c.size());
+        for (auto const& elem : c)
+            result.emplace_back(elem ? elem->clone() : nullptr);
+
+        return result;
+    }
+};
+
+template<typename Bench>
+static typename Bench::container _make_Container(std::vector<int> const& _Values)
+{
+    typename Bench::container c;
+    for (int value : _Values)
+        Bench::push(c, _make_Object(value));
+
+    return c;
+}
+
+template<typename Bench>
+static typename Bench::container _copy_Container(typename Bench::container const& _Container)
+{
+    if constexpr (requires { Bench::copy(_Container); })
+        return Bench::copy(_Container);
+    else
+        return _Container;
+}
+
+//Measurement
+
+struct Result
+{
+    double ns_per_op;
+    double allocs_per_op;
+    ptrdiff_t peak_heap_bytes;
+};
+
+//Run _Setup (untimed) and _Run (timed, returns the number of operations it did) until min_time of wall clock,
+//setup included, has passed. There is always one pass, so a size whose single pass is longer runs only once
+template<typename Setup, typename Run>
+static Result _measure(std::chrono::milliseconds _Min_Time, Setup _Setup, Run _Run)
+{
+    using clock = std::chrono::steady_clock;
+
+    auto deadline = clock::now() + _Min_Time;
+    clock::duration elapsed{};
+    size_t ops = 0;
+    size_t allocations = 0;
+    ptrdiff_t peak = 0;
+
+    do
+    {
+        auto state = _Setup();
+
+        size_t allocations_before = _allocations.load();
+        ptrdiff_t live_before = _live_bytes.load();
+        _peak_bytes = live_before;
+
+        auto start = clock::now();
+        ops += _Run(state);
+        elapsed += clock::now() - start;
+
+        allocations += _allocations.load() - allocations_before;
+        peak = std::max(peak, _peak_bytes.load() - live_before);
+    } while (clock::now() < deadline);
+
+    double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return { ns / double(ops), double(allocations) / double(ops), _tracks_bytes ? peak : -1 };
+}
+
+static void _print_Record(bool& _First, char const* _Case, char const* _Container, size_t _Size, Result const& _Result)
+{
+    std::cout << (_First ? "\n" : ",\n")
+        << "  {\"case\": \"" << _Case << "\", \"container\": \"" << _Container << "\", \"size\": " << _Size
+        << ", \"ns_per_op\": " << _Result.ns_per_op << ", \"allocs_per_op\": " << _Result.allocs_per_op
+        << ", \"peak_heap_bytes\": " << _Result.peak_heap_bytes << ", \"peak_rss_kib\": " << _peak_Rss_kib() << "}"
+        << std::flush;
+
+    _First = false;
+}
+
+//Mid-array operations are O(n) for both containers, so only this many are timed per pass
+static constexpr size_t _shift_ops = 1000;
+
+template<typename Bench>
+static void _run_Cases(std::string const& _Only, size_t _Size, std::chrono::milliseconds _Min_Time, bool& _First)
+{
+    using container = typename Bench::container;
+    auto values = _shuffled_Values(_Size);
+    auto wanted = [&_Only](char const* name) { return _Only.empty() || _Only == name; };
+    auto report = [&](char const* name, Result const& result) { _print_Record(_First, name, Bench::name, _Size, result); };
+    auto fresh = [&values] { return _make_Container<Bench>(values); };
+
+    if (wanted("emplace_back"))
+        report("emplace_back", _measure(_Min_Time, [] { return container(); }, [&values](container& c)
+        {
+            for (int value : values)
+                Bench::push(c, _make_Object(value));
+            return values.size();
+        }));
+
+    if (wanted("emplace_mid"))
+        report("emplace_mid", _measure(_Min_Time, fresh, [](container& c)
+        {
+            for (size_t i = 0; i < _shift_ops; ++i)
+                Bench::insert(c, c.size() / 2, _make_Object(int(i)));
+            return _shift_ops;
+        }));
+
+    if (wanted("erase_front"))
+        report("erase_front", _measure(_Min_Time, fresh, [](container& c)
+        {
+            size_t ops = std::min(_shift_ops, c.size());
+            for (size_t i = 0; i < ops; ++i)
+                Bench::erase(c, 0);
+            return ops;
+        }));
+
+    if (wanted("erase_mid"))
+        report("erase_mid", _measure(_Min_Time, fresh, [](container& c)
+        {
+            size_t ops = std::min(_shift_ops, c.size());
+            for (size_t i = 0; i < ops; ++i)
+                Bench::erase(c, c.size() / 2);
+            return ops;
+        }));
+
+    //Copy counts one op per element, move one op; the results are destroyed outside of the timed part
+    if (wanted("copy"))
+    {
+        auto source = fresh();
+        report("copy", _measure(_Min_Time, [] { return std::optional<container>(); }, [&source](std::optional<container>& copy)
+        {
+            copy.emplace(_copy_Container<Bench>(source));
+            return std::max<size_t>(copy->size(), 1);
+        }));
+    }
+
+    if (wanted("move"))
+        report("move", _measure(_Min_Time, [&fresh] { return std::pair(fresh(), std::optional<container>()); },
+            [](std::pair<container, std::optional<container>>& state)
+        {
+            state.second.emplace(std::move(state.first));
+            return size_t(1);
+        }));
+
+    //Sorts count one op per element
+    if (wanted("sort"))
+        report("sort", _measure(_Min_Time, fresh, [](container& c)
+        {
+            std::ranges::sort(c, [](auto const& a, auto const& b) { return a->getValue() < b->getValue(); });
+            return std::max<size_t>(c.size(), 1);
+        }));
+
+    if (wanted("sort_projection"))
+        report("sort_projection", _measure(_Min_Time, fresh, [](container& c)
+        {
+            std::ranges::sort(c, std::ranges::less(), [](auto const& elem) { return elem->getValue(); });
+            return std::max<size_t>(c.size(), 1);
+        }));
+
+    if constexpr (std::is_same_v<Bench, PtrArrayBench>)
+        if (wanted("sort_by"))
+            report("sort_by", _measure(_Min_Time, fresh, [](container& c)
+            {
+                c.sort_by(&Base::getValue);
+                return std::max<size_t>(c.size(), 1);
+            }));
+
+    //Scans go over elements whose objects were allocated in a different order, as in a long-lived array
+    if (wanted("scan") || wanted("scan_prefetched"))
+    {
+        auto c = fresh();
+        std::ranges::sort(c, [](auto const& a, auto const& b) { return a->getValue() < b->getValue(); });
+        long long sink = 0;
+
+        if (wanted("scan"))
+            report("scan", _measure(_Min_Time, [] { return 0; }, [&c, &sink](int&)
+            {
+                for (size_t i = 0; i < c.size(); ++i)
+                    sink += Bench::get(c, i)->getValue();
+                return std::max<size_t>(c.size(), 1);
+            }));
+
+        if constexpr (std::is_same_v<Bench, PtrArrayBench>)
+            if (wanted("scan_prefetched"))
+                report("scan_prefetched", _measure(_Min_Time, [] { return 0; }, [&c, &sink](int&)
+                {
+                    c.for_each_prefetched([&sink](Base const* elem) { sink += elem->getValue(); });
+                    return std::max<size_t>(c.size(), 1);
+                }));
+
+        if (sink == 42)
+            std::cerr << "";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t max_size = 1'000'000;
+    std::chrono::milliseconds min_time(100);
+    std::string only;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string_view option = argv[i];
+        if (option == "--max-size") max_size = std::stoull(argv[i + 1]);
+        else if (option == "--min-time-ms") min_time = std::chrono::milliseconds(std::stoll(argv[i + 1]));
+        else if (option == "--case") only = argv[i + 1];
+        else
+        {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    bool first = true;
+    std::cout << "[";
+    for (size_t size = 10; size <= max_size; size *= 10)
+    {
+        _run_Cases<PtrArrayBench>(only, size, min_time, first);
+        _run_Cases<VectorBench>(only, size, min_time, first);
+    }
+    std::cout << "\n]" << std::endl;
+}
@@ -3,7 +3,9 @@
 
 int main()
 {
+#ifdef _MSC_VER
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
 
    /* test();
     test_copy_constructor();
@@ -14,7 +16,32 @@ int main()
     test_clear();
     test_erase();
     test_stl();
-    test_std_sort();*/
+    test_std_sort();
+    test_arena_allocator();
+    test_copy_on_write();
+    test_poly_collection();
+    test_sort_by();
+    test_parallel_algorithms();
+    test_parallel_copy();
+    test_front_operations();
+    test_range_insertion();
+    test_growth_policy();
+    test_relocation();
+    test_erase_if();
+    test_deferred_reclamation();
+    test_concurrent_append();
+    test_rcu_snapshots();
+    test_slot_handles();
+    test_prefetched_iteration();
+    test_indexed_array();
+    test_serialization();
+    test_mapped_array();
+    test_stats();
+    test_variant_array();
+    test_small_array();
+    test_static_array();
+    test_column_array();
+    test_foreign_wrappers();*/
 
     PtrArray<Base> arr(new Derived1(1), new Derived1(3), new Derived1(2), new Derived1(5), new Derived1(4));
     
@@ -22,5 +49,7 @@ int main()
         [](Base const* obj) {return obj->getValue(); });
 
     std::print("asd{0}", 1);
+#ifdef _MSC_VER
     _CrtDumpMemoryLeaks();
+#endif
 }
@@ -8,3 +8,32 @@
 #include <print>
 #include <random>
 #include <numeric>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <span>
+#include <typeindex>
+#include <stdexcept>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <execution>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <sstream>
+#include <fstream>
+#include <optional>
+#include <variant>
+#include <array>
+#include <filesystem>
+#include <system_error>
@@ -1,5 +1,17 @@
 #include "Base.cpp"
 #include "PtrArray.cpp"
+#include "CowPtrArray.cpp"
+#include "PolyPtrArray.cpp"
+#include "ParallelAlgorithms.cpp"
+#include "ConcurrentPtrArray.cpp"
+#include "RcuPtrArray.cpp"
+#include "SlotPtrArray.cpp"
+#include "IndexedPtrArray.cpp"
+#include "MappedPtrArray.cpp"
+#include "VariantPtrArray.cpp"
+#include "SmallPtrArray.cpp"
+#include "StaticPtrArray.cpp"
+#include "ColumnPtrArray.cpp"
 
 static void test()
 {
@@ -495,3 +507,1663 @@ static void test_erase() {
     assert(arr[0]->getValue() == 3);
     assert(arr[1]->getValue() == 2);
 }
+
+static void test_arena_allocator() {
+    PtrArray<Base, ArenaAllocator> arr;
+    arr.emplace_back(new Derived1(3));
+    arr.emplace_back_new<Derived2>(1);
+    arr.emplace_new<Derived1>(arr.begin() + 1, 2);
+
+    assert(arr.size() == 3);
+    assert(arr[0]->getValue() == 3);
+    assert(arr[1]->getValue() == 2);
+    assert(arr[2]->getValue() == 1);
+    assert(dynamic_cast<Derived2*>(arr[2]) != nullptr);
+    assert(arr.get_allocator().arena()->bytes_used() >= 3 * sizeof(Derived1));
+
+    // Copies get their own arena
+    PtrArray<Base, ArenaAllocator> copied_arr = arr;
+    assert(copied_arr.get_allocator().arena() != arr.get_allocator().arena());
+    assert(copied_arr[0] != arr[0] && copied_arr[0]->getValue() == 3);
+
+    std::ranges::sort(arr, std::less(), [](Base const* obj) { return obj->getValue(); });
+    assert(arr[0]->getValue() == 1);
+    assert(arr[1]->getValue() == 2);
+    assert(arr[2]->getValue() == 3);
+
+    arr.erase(arr.begin());
+    assert(arr.size() == 2);
+    assert(arr[0]->getValue() == 2);
+
+    // Clearing drops the arena in bulk and the array can be refilled
+    arr.clear();
+    assert(arr.empty());
+    assert(arr.get_allocator().arena()->bytes_used() == 0);
+
+    for (int i = 0; i < 100; ++i)
+        arr.emplace_back_new<Derived1>(i);
+    assert(arr.size() == 100);
+    assert(arr[99]->getValue() == 99);
+
+    PtrArray<Base, ArenaAllocator> moved_arr = std::move(arr);
+    assert(moved_arr.size() == 100);
+    assert(moved_arr[50]->getValue() == 50);
+    assert(arr.empty());
+}
+
+static void test_copy_on_write() {
+    PtrArray<Base> source;
+    source.emplace_back(new Derived1(3));
+    source.emplace_back(new Derived2(1));
+    source.emplace_back(new Derived1(2));
+
+    CowPtrArray<Base> arr(source);
+    assert(arr.size() == 3);
+    assert(std::as_const(arr)[0] != source[0]);
+
+    // Copies share the block and the pointees
+    CowPtrArray<Base> snapshot = arr;
+    assert(arr.is_shared() && snapshot.is_shared());
+    assert(std::as_const(snapshot)[1] == std::as_const(arr)[1]);
+
+    auto count_gt_1 = std::ranges::count_if(std::as_const(snapshot), [](Base const* obj) {
+        return obj->getValue() > 1; });
+    assert(count_gt_1 == 2);
+    assert(snapshot.is_shared());
+
+    // Mutable access unshares the block and clones only the touched element
+    Base* first = arr[0];
+    assert(!arr.is_shared() && !snapshot.is_shared());
+    assert(first != std::as_const(snapshot)[0]);
+    assert(std::as_const(arr)[1] == std::as_const(snapshot)[1]);
+    *first = Derived1(10);
+    assert(arr[0]->getValue() == 10);
+    assert(snapshot[0]->getValue() == 3);
+
+    // Modifiers never leak into the snapshot
+    arr.emplace_back(new Derived2(4));
+    arr.erase(arr.cbegin() + 1);
+    assert(arr.size() == 3);
+    assert(arr[1]->getValue() == 2 && arr[2]->getValue() == 4);
+    assert(snapshot.size() == 3);
+    assert(snapshot[1]->getValue() == 1);
+
+    int sum = 0;
+    for (auto it = arr.begin(); it != arr.end(); ++it)
+        sum += it->getValue();
+    assert(sum == 16);
+
+    std::ranges::for_each(snapshot, [](Base* obj) { *obj = Derived1(obj->getValue() + 1); });
+    assert(snapshot[0]->getValue() == 4);
+    assert(arr[0]->getValue() == 10);
+
+    snapshot.clear();
+    assert(snapshot.empty());
+    assert(arr.size() == 3);
+    assert(!snapshot[0] && !std::as_const(snapshot)[5]);
+
+    CowPtrArray<Base> empty;
+    assert(!empty[0] && !std::as_const(empty)[0]);
+}
+
+static void test_poly_collection() {
+    PolyPtrArray<Base> arr;
+    arr.register_type<Derived1>();
+    arr.register_type<Derived2>();
+
+    Derived2 prototype(6);
+    arr.emplace_back(new Derived1(1), new Derived2(2), new Derived1(3));
+    arr.emplace<Derived2>(4);
+    arr.emplace<Derived1>(5);
+    arr.insert(prototype);
+
+    assert(arr.size() == 6);
+    assert(arr.size<Derived1>() == 3);
+    assert(arr.size<Derived2>() == 3);
+
+    // Elements of a type are contiguous and keep their relative order
+    auto derived1 = arr.segment<Derived1>();
+    assert(derived1.size() == 3);
+    assert(derived1[0].getValue() == 1 && derived1[1].getValue() == 3 && derived1[2].getValue() == 5);
+    assert(&derived1[1] == &derived1[0] + 1);
+
+    // Whole-array passes see every element once
+    auto sum = std::accumulate(arr.begin(), arr.end(), 0, [](int acc, Base const* obj) {
+        return acc + obj->getValue(); });
+    assert(sum == 21);
+
+    auto count_gt_2 = std::ranges::count_if(arr, [](Base const* obj) {
+        return obj->getValue() > 2; });
+    assert(count_gt_2 == 4);
+
+    int typed_sum = 0;
+    arr.for_each<Derived1, Derived2>([&typed_sum](auto const& obj) { typed_sum += obj.getValue(); });
+    assert(typed_sum == 21);
+
+    int derived2_sum = 0;
+    arr.for_each<Derived2>([&derived2_sum](auto const& obj) {
+        if constexpr (std::is_same_v<std::remove_cvref_t<decltype(obj)>, Derived2>)
+            derived2_sum += obj.getValue(); });
+    assert(derived2_sum == 12);
+
+    // Copy is deep
+    PolyPtrArray<Base> copied_arr = arr;
+    auto find_it = std::ranges::find_if(arr, [](Base const* obj) { return obj->getValue() == 3; });
+    assert(find_it != arr.end());
+    arr.erase(find_it);
+    assert(arr.size() == 5);
+    assert(arr.segment<Derived1>()[1].getValue() == 5);
+    assert(copied_arr.size() == 6);
+    assert(copied_arr.segment<Derived1>()[1].getValue() == 3);
+
+    arr.clear();
+    assert(arr.empty());
+    arr.insert(prototype);
+    assert(arr.size<Derived2>() == 1);
+}
+
+static void test_sort_by() {
+    PtrArray<Base> arr(new Derived1(3), new Derived2(1), new Derived1(4), new Derived2(1), new Derived1(5), new Derived2(9), new Derived1(2));
+    Base* first_one = arr[1];
+
+    arr.sort_by([](Base const* obj) { return obj->getValue(); });
+    for (size_t i = 1; i < arr.size(); ++i)
+        assert(arr[i - 1]->getValue() <= arr[i]->getValue());
+    assert(arr[6]->getValue() == 9);
+
+    // Descending order through a member projection
+    arr.sort_by(&Base::getValue, std::greater());
+    assert(arr[0]->getValue() == 9);
+    assert(arr[6]->getValue() == 1);
+
+    // Equal keys keep their order
+    PtrArray<Base> stable(new Derived1(2), new Derived1(1), new Derived2(2), new Derived2(1));
+    Base* second_two = stable[2];
+    stable.stable_sort_by(&Base::getValue);
+    assert(stable[0]->getValue() == 1 && dynamic_cast<Derived1*>(stable[0]) != nullptr);
+    assert(stable[1]->getValue() == 1 && dynamic_cast<Derived2*>(stable[1]) != nullptr);
+    assert(stable[3] == second_two);
+
+    auto found = arr.lower_bound_by(3, &Base::getValue, std::greater());
+    assert(found != arr.end() && found->getValue() == 3);
+
+    arr.sort_by(&Base::getValue);
+    auto one = arr.lower_bound_by(1, &Base::getValue);
+    assert(one == arr.begin());
+    assert(one->getValue() == 1 && (arr[0] == first_one || arr[1] == first_one));
+    assert(arr.lower_bound_by(10, &Base::getValue) == arr.end());
+
+    std::ranges::shuffle(arr, std::mt19937(42));
+    arr.nth_element_by(arr.begin() + 3, &Base::getValue);
+    assert(arr[3]->getValue() == 3);
+    for (size_t i = 0; i < 3; ++i)
+        assert(arr[i]->getValue() <= 3);
+    for (size_t i = 4; i < arr.size(); ++i)
+        assert(arr[i]->getValue() >= 3);
+
+    // Comparison of wrappers uses Base::operator<=>
+    std::ranges::sort(arr, std::less<PtrArray<Base>::value_type>());
+    assert(arr[0]->getValue() == 1 && arr[6]->getValue() == 9);
+}
+
+static void test_parallel_algorithms() {
+    ThreadPool pool(4);
+
+    PtrArray<Base> arr;
+    for (int i = 0; i < 20000; ++i) {
+        if (i % 2)
+            arr.emplace_back(new Derived1((i * 7919) % 20000));
+        else
+            arr.emplace_back(new Derived2((i * 7919) % 20000));
+    }
+
+    auto sum = parallel_transform_reduce(arr, 0ll, std::plus(), [](Base const* obj) -> long long {
+        return obj->getValue(); }, pool);
+    assert(sum == 19999ll * 20000 / 2);
+
+    std::atomic<int> count_gt_9999 = 0;
+    parallel_for_each(arr, [&count_gt_9999](Base const* obj) {
+        if (obj->getValue() > 9999) ++count_gt_9999; }, pool);
+    assert(count_gt_9999 == 10000);
+
+    auto find_it = parallel_find_if(arr, [](Base const* obj) { return obj->getValue() == 1234; }, pool);
+    assert(find_it != arr.end() && find_it->getValue() == 1234);
+    assert(find_it == std::ranges::find_if(arr, [](Base const* obj) { return obj->getValue() == 1234; }));
+    assert(parallel_find_if(arr, [](Base const* obj) { return obj->getValue() < 0; }, pool) == arr.end());
+
+    parallel_sort(arr, std::less(), [](Base const* obj) { return obj->getValue(); }, pool);
+    for (int i = 0; i < 20000; ++i)
+        assert(arr[i]->getValue() == i);
+
+    parallel_sort(arr, [](Base const* a, Base const* b) { return a->getValue() > b->getValue(); }, std::identity(), pool);
+    for (int i = 0; i < 20000; ++i)
+        assert(arr[i]->getValue() == 19999 - i);
+
+    // Standard execution policies work on begin()/end()
+    std::sort(std::execution::par, arr.begin(), arr.end(), [](Base const* a, Base const* b) {
+        return a->getValue() < b->getValue(); });
+    assert(arr[0]->getValue() == 0 && arr[19999]->getValue() == 19999);
+
+    auto count_odd = std::count_if(std::execution::par_unseq, arr.begin(), arr.end(), [](Base const* obj) {
+        return obj->getValue() % 2; });
+    assert(count_odd == 10000);
+}
+
+//Counts live objects and fails to clone once the budget is over
+class FlakyClone final : public Base {
+    //Bigger than Base, so byte counts have to go by the dynamic type
+    std::array<char, 32> _payload{};
+
+public:
+    static inline std::atomic<int> alive = 0;
+    static inline std::atomic<int> clone_budget = 0;
+
+    explicit FlakyClone(int a) : Base(a) { ++alive; }
+    FlakyClone(FlakyClone const& other) : Base(other) { ++alive; }
+    ~FlakyClone() override { --alive; }
+
+    void display() const override { std::cout << "FlakyClone" << std::endl; }
+
+    Base* clone() const override
+    {
+        if (--clone_budget < 0)
+            throw std::runtime_error("Clone budget is over");
+
+        return new FlakyClone(*this);
+    }
+
+    Base* clone(Arena& arena) const override
+    {
+        return arena.create<FlakyClone>(*this);
+    }
+
+    size_t size_bytes() const override { return sizeof(FlakyClone); }
+};
+
+static void test_parallel_copy() {
+    ThreadPool pool(4);
+
+    PtrArray<Base> arr;
+    for (int i = 0; i < 10000; ++i) {
+        if (i % 2)
+            arr.emplace_back(new Derived1(i));
+        else
+            arr.emplace_back(new Derived2(i));
+    }
+
+    PtrArray<Base> copied_arr(arr, pool);
+    assert(copied_arr.size() == arr.size());
+    for (size_t i = 0; i < arr.size(); ++i) {
+        assert(copied_arr[i] != arr[i]);
+        assert(copied_arr[i]->getValue() == arr[i]->getValue());
+        assert(typeid(*copied_arr[i]) == typeid(*arr[i]));
+    }
+
+    copied_arr.emplace_back(new Derived1(10000));
+    assert(copied_arr.size() == 10001 && copied_arr[10000]->getValue() == 10000);
+
+    // Arena arrays fall back to cloning on the calling thread
+    PtrArray<Base, ArenaAllocator> arena_arr;
+    arena_arr.emplace_back_new<Derived1>(1);
+    arena_arr.emplace_back_new<Derived2>(2);
+    PtrArray<Base, ArenaAllocator> arena_copy(arena_arr, pool);
+    assert(arena_copy.size() == 2 && arena_copy[1]->getValue() == 2);
+
+    // A throwing clone leaves nothing behind
+    PtrArray<Base> flaky;
+    for (int i = 0; i < 5000; ++i)
+        flaky.emplace_back(new FlakyClone(i));
+    assert(FlakyClone::alive == 5000);
+
+    FlakyClone::clone_budget = 3000;
+    PtrArray<Base> target;
+    target.emplace_back(new Derived1(1));
+    try {
+        target.clone_from(flaky, pool);
+        assert(false); // Should throw
+    }
+    catch (std::runtime_error const&) {
+        // Expected to throw
+    }
+    assert(target.empty());
+    assert(FlakyClone::alive == 5000);
+
+    FlakyClone::clone_budget = 5000;
+    target.clone_from(flaky, pool);
+    assert(target.size() == 5000 && FlakyClone::alive == 10000);
+    assert(target[4999]->getValue() == 4999);
+}
+
+static void test_front_operations() {
+    PtrArray<Base> arr;
+    for (int i = 0; i < 10; ++i)
+        arr.emplace_back(new Derived1(i));
+
+    // Erasing the front only moves the head, the other slots stay in place
+    auto second = &*(arr.begin() + 1);
+    arr.pop_front();
+    assert(arr.size() == 9);
+    assert(&*arr.begin() == second);
+    assert(arr[0]->getValue() == 1);
+
+    arr.erase(arr.begin());
+    assert(&*arr.begin() == second + 1);
+    arr.erase(arr.begin(), arr.begin() + 2);
+    assert(arr.size() == 6 && arr[0]->getValue() == 4);
+
+    // Pushing to the front reuses the room left by the erased elements
+    arr.push_front(new Derived2(3));
+    assert(&*arr.begin() == second + 2);
+    arr.emplace_front(new Derived1(1), new Derived2(2));
+    assert(arr.size() == 9);
+    for (int i = 0; i < 9; ++i)
+        assert(arr[i]->getValue() == i + 1);
+
+    // Queue-like usage
+    PtrArray<Base> queue;
+    int next = 0, expected = 0;
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 30; ++i)
+            queue.emplace_back(new Derived1(next++));
+        for (int i = 0; i < 20; ++i) {
+            assert(queue[0]->getValue() == expected++);
+            queue.pop_front();
+        }
+    }
+    assert(queue.size() == 1000);
+    assert(queue[999]->getValue() == next - 1);
+
+    // Deque-like usage
+    PtrArray<Base> deque;
+    for (int i = 0; i < 1000; ++i) {
+        deque.push_front(new Derived1(-i));
+        deque.push_back(new Derived2(i + 1));
+    }
+    assert(deque.size() == 2000);
+    for (int i = 0; i < 2000; ++i)
+        assert(deque[i]->getValue() == i - 999);
+
+    deque.emplace(deque.begin() + 5, new Derived1(100));
+    assert(deque[5]->getValue() == 100 && deque[6]->getValue() == -994);
+    deque.erase(deque.begin() + 5);
+    deque.pop_back();
+    assert(deque.size() == 1999 && deque[1998]->getValue() == 999);
+
+    std::ranges::sort(deque, std::greater(), [](Base const* obj) { return obj->getValue(); });
+    assert(deque[0]->getValue() == 999 && deque[1998]->getValue() == -999);
+    assert(std::ranges::find_if(deque, [](Base const* obj) { return obj->getValue() == 0; }) == deque.begin() + 999);
+
+    PtrArray<Base> copied = deque;
+    assert(copied.size() == 1999 && copied[1998]->getValue() == -999);
+
+    while (!deque.empty())
+        deque.pop_front();
+    deque.push_back(new Derived1(7));
+    assert(deque.size() == 1 && deque[0]->getValue() == 7);
+}
+
+static void test_range_insertion() {
+    PtrArray<Base> arr(new Derived1(0), new Derived1(5));
+
+    // Lvalue pointers are cloned, the source keeps its objects
+    std::vector<Base*> raw = { new Derived1(1), new Derived2(2) };
+    arr.insert(arr.begin() + 1, raw.begin(), raw.end());
+    assert(arr.size() == 4);
+    assert(arr[1]->getValue() == 1 && arr[2]->getValue() == 2);
+    assert(arr[1] != raw[0] && dynamic_cast<Derived2*>(arr[2]) != nullptr);
+
+    // Rvalue pointers are adopted
+    Base* adopted = raw[0];
+    arr.insert(arr.begin() + 3, std::make_move_iterator(raw.begin()), std::make_move_iterator(raw.end()));
+    assert(arr.size() == 6);
+    assert(arr[3] == adopted);
+    assert(arr[4]->getValue() == 2 && arr[5]->getValue() == 5);
+
+    // unique_ptrs give up their objects when moved
+    std::vector<std::unique_ptr<Base>> owned;
+    for (int i = 6; i < 10; ++i)
+        owned.push_back(std::make_unique<Derived1>(i));
+    Base* sixth = owned[0].get();
+    arr.append_range(std::ranges::subrange(std::make_move_iterator(owned.begin()), std::make_move_iterator(owned.end())));
+    assert(arr.size() == 10);
+    assert(arr[6] == sixth && !owned[0]);
+    int expected[] = { 0, 1, 2, 1, 2, 5, 6, 7, 8, 9 };
+    for (int i = 0; i < 10; ++i)
+        assert(arr[i]->getValue() == expected[i]);
+
+    std::vector<std::unique_ptr<Base>> kept;
+    kept.push_back(std::make_unique<Derived2>(42));
+    arr.insert_range(arr.begin(), kept);
+    assert(arr[0]->getValue() == 42 && arr[0] != kept[0].get());
+
+    // Wrappers of another array
+    PtrArray<Base> other(new Derived1(100), new Derived2(101));
+    arr.append_range(other);
+    assert(arr.size() == 13 && other.size() == 2);
+    assert(arr[11]->getValue() == 100 && arr[11] != other[0]);
+
+    arr.assign_range(std::views::iota(0, 50) | std::views::transform([](int i) -> Base* { return new Derived1(i); }));
+    assert(arr.size() == 50);
+    for (int i = 0; i < 50; ++i)
+        assert(arr[i]->getValue() == i);
+
+    // A throwing clone leaves the array as it was
+    PtrArray<Base> flaky;
+    for (int i = 0; i < 10; ++i)
+        flaky.emplace_back(new FlakyClone(i));
+    FlakyClone::clone_budget = 5;
+    try {
+        arr.insert_range(arr.begin() + 10, flaky);
+        assert(false); // Should throw
+    }
+    catch (std::runtime_error const&) {
+        // Expected to throw
+    }
+    assert(arr.size() == 50);
+    for (int i = 0; i < 50; ++i)
+        assert(arr[i]->getValue() == i);
+}
+
+static void test_growth_policy() {
+    //reserve and shrink_to_fit
+    PtrArray<Base> arr;
+    assert(arr.capacity() == 0);
+    arr.reserve(100);
+    assert(arr.capacity() == 100);
+    for (int i = 0; i < 100; ++i)
+        arr.emplace_back(new Derived1(i));
+    assert(arr.capacity() == 100);
+
+    arr.erase(arr.begin() + 10, arr.end());
+    arr.shrink_to_fit();
+    assert(arr.capacity() == 10 && arr.size() == 10);
+    for (int i = 0; i < 10; ++i)
+        assert(arr[i]->getValue() == i);
+
+    //clear keeps the memory, release frees it
+    arr.clear();
+    assert(arr.empty() && arr.capacity() == 10);
+    arr.emplace_back(new Derived2(7));
+    assert(arr[0]->getValue() == 7 && arr.capacity() == 10);
+    arr.release();
+    assert(arr.empty() && arr.capacity() == 0);
+    arr.emplace_back(new Derived2(8));
+    assert(arr[0]->getValue() == 8);
+    arr.clear();
+    arr.shrink_to_fit();
+    assert(arr.capacity() == 0);
+
+    //Fixed chunks
+    PtrArray<Base, HeapAllocator, ChunkGrowth<16>> chunked;
+    for (int i = 0; i < 40; ++i)
+    {
+        chunked.emplace_back(new Derived1(i));
+        assert(chunked.capacity() % 16 == 0);
+    }
+    assert(chunked.capacity() == 48);
+
+    //User callback
+    size_t calls = 0;
+    CallbackGrowth growth{ [&calls](size_t, size_t required) { ++calls; return required + 3; } };
+    PtrArray<Base, HeapAllocator, CallbackGrowth> custom(HeapAllocator{}, growth);
+    for (int i = 0; i < 10; ++i)
+        custom.emplace_back(new Derived1(i));
+    assert(calls > 0 && custom.size() == 10);
+    assert(custom.capacity() >= 10 && custom.capacity() <= 13);
+
+    auto copy = custom;
+    copy.emplace_back(new Derived1(10));
+    assert(copy.size() == 11 && copy[10]->getValue() == 10);
+
+    //Sizes whose byte count would wrap are rejected before anything is allocated
+    static_assert(PtrArray<Base>::max_size() == std::numeric_limits<size_t>::max() / sizeof(PtrArray<Base>::value_type));
+    for (size_t huge : { copy.max_size() + 1, std::numeric_limits<size_t>::max() })
+    {
+        bool thrown = false;
+        try { copy.reserve(huge); }
+        catch (std::length_error const&) { thrown = true; }
+        assert(thrown && copy.size() == 11 && copy.capacity() < 100);
+    }
+    copy.emplace_back(new Derived1(11));
+    assert(copy[11]->getValue() == 11);
+}
+
+static void test_relocation() {
+    //Random inserts and erases checked against a vector of values, slots are moved as bytes
+    auto check = [](auto arr) {
+        std::mt19937 gen(17);
+        std::vector<int> model;
+
+        for (int i = 0; i < 2000; ++i)
+        {
+            size_t pos = model.empty() ? 0 : gen() % (model.size() + 1);
+            if (gen() % 3 && model.size() < 500)
+            {
+                arr.emplace(arr.begin() + pos, new Derived1(i));
+                model.insert(model.begin() + pos, i);
+            }
+            else if (!model.empty())
+            {
+                size_t count = std::min<size_t>(gen() % 4 + 1, model.size() - std::min(pos, model.size() - 1));
+                pos = std::min(pos, model.size() - 1);
+                arr.erase(arr.begin() + pos, arr.begin() + pos + count);
+                model.erase(model.begin() + pos, model.begin() + pos + count);
+            }
+
+            if (i % 250 == 0)
+                arr.shrink_to_fit();
+        }
+
+        assert(arr.size() == model.size());
+        for (size_t i = 0; i < model.size(); ++i)
+            assert(arr[i]->getValue() == model[i]);
+
+        auto copy = arr;
+        arr.release();
+        for (size_t i = 0; i < model.size(); ++i)
+            assert(copy[i]->getValue() == model[i]);
+    };
+
+    check(PtrArray<Base>());
+    check(PtrArray<Base, ArenaAllocator>());
+}
+
+static void test_erase_if() {
+    PtrArray<Base> arr;
+    for (int i = 0; i < 100; ++i)
+        arr.emplace_back(new Derived1(i));
+
+    //Every tenth element goes
+    size_t removed = arr.erase_if([](Base const* b) { return b->getValue() % 10 == 0; });
+    assert(removed == 10 && arr.size() == 90);
+    for (size_t i = 0, value = 0; i < arr.size(); ++i, ++value)
+    {
+        if (value % 10 == 0)
+            ++value;
+        assert(arr[i]->getValue() == int(value));
+    }
+
+    //remove_if keeps the rejected elements alive at the tail
+    auto tail = arr.remove_if([](Base const* b) { return b->getValue() >= 50; });
+    assert(tail - arr.begin() == 45 && arr.size() == 90);
+    for (auto it = tail; it != arr.end(); ++it)
+        assert(it->getValue() >= 50);
+    arr.erase(tail, arr.end());
+    assert(arr.size() == 45 && arr[44]->getValue() == 49);
+
+    assert(arr.erase_if([](Base const*) { return false; }) == 0 && arr.size() == 45);
+    assert(arr.erase_if([](Base const*) { return true; }) == 45 && arr.empty());
+
+    //Pointees from an arena are destroyed through its handle
+    PtrArray<Base, ArenaAllocator> arena_arr{ ArenaAllocator() };
+    for (int i = 0; i < 20; ++i)
+        arena_arr.emplace_back_new<Derived2>(i);
+    assert(arena_arr.erase_if([](Base const* b) { return b->getValue() & 1; }) == 10);
+    for (size_t i = 0; i < arena_arr.size(); ++i)
+        assert(arena_arr[i]->getValue() == int(i * 2));
+}
+
+static void test_deferred_reclamation() {
+    FlakyClone::alive = 0;
+
+    //Manual draining
+    {
+        Reclaimer reclaimer;
+        PtrArray<Base, DeferredAllocator> arr{ DeferredAllocator(reclaimer) };
+        for (int i = 0; i < 100; ++i)
+            arr.emplace_back_new<FlakyClone>(i);
+        assert(FlakyClone::alive == 100);
+
+        arr.erase(arr.begin(), arr.begin() + 10);
+        arr.pop_back();
+        assert(FlakyClone::alive == 100);
+        assert(reclaimer.pending() == 11 && reclaimer.pending_bytes() == 11 * sizeof(FlakyClone));
+        static_assert(sizeof(FlakyClone) > sizeof(Base));
+
+        assert(reclaimer.drain(5) == 5 && FlakyClone::alive == 95 && reclaimer.pending() == 6);
+        assert(reclaimer.drain() == 6 && FlakyClone::alive == 89);
+        assert(reclaimer.pending() == 0 && reclaimer.pending_bytes() == 0);
+
+        //Moved-out elements go back to the heap on their own
+        PtrArray<Base>::value_type detached(static_cast<Base*>(new FlakyClone(-1)));
+        *arr.begin() = nullptr;
+        assert(reclaimer.pending() == 1);
+
+        arr.clear();
+        assert(FlakyClone::alive == 90 && reclaimer.pending() == 89);
+        reclaimer.flush();
+        assert(FlakyClone::alive == 1 && reclaimer.pending() == 0);
+    }
+    assert(FlakyClone::alive == 0);
+
+    //Background thread
+    {
+        Reclaimer reclaimer(std::chrono::milliseconds(1));
+        {
+            PtrArray<Base, DeferredAllocator> arr{ DeferredAllocator(reclaimer) };
+            for (int i = 0; i < 1000; ++i)
+                arr.emplace_back_new<FlakyClone>(i);
+
+            FlakyClone::clone_budget = 1000;
+            auto copy = arr;
+            assert(FlakyClone::alive == 2000);
+        }
+
+        for (int i = 0; i < 10000 && reclaimer.pending(); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        assert(reclaimer.pending() == 0 && FlakyClone::alive == 0);
+    }
+}
+
+static void test_concurrent_append() {
+    ConcurrentPtrArray<Base> arr;
+    constexpr int writers = 4, per_writer = 20000;
+
+    //Readers index whatever is published while the writers append
+    std::atomic<bool> done = false;
+    std::thread reader([&] {
+        size_t seen = 0;
+        while (!done || seen < arr.size())
+        {
+            size_t size = arr.size();
+            assert(size >= seen);
+            for (size_t i = seen; i < size; ++i)
+                assert(arr[i] != nullptr && arr[i]->getValue() % per_writer < per_writer);
+            seen = size;
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w)
+        threads.emplace_back([&arr, w] {
+            for (int i = 0; i < per_writer; ++i)
+                if (i % 2) arr.push_back(static_cast<Base*>(new Derived1(w * per_writer + i)));
+                else arr.emplace_back_new<Derived2>(w * per_writer + i);
+        });
+
+    for (auto& thread : threads)
+        thread.join();
+    done = true;
+    reader.join();
+
+    //Every value got in exactly once
+    assert(arr.size() == writers * per_writer);
+    std::vector<int> values;
+    for (Base* elem : arr)
+        values.push_back(elem->getValue());
+    std::ranges::sort(values);
+    for (int i = 0; i < writers * per_writer; ++i)
+        assert(values[i] == i);
+
+    //Elements keep their addresses while the array grows
+    Base* first = arr[0];
+    for (int i = 0; i < 100000; ++i)
+        arr.emplace_back_new<Derived1>(i);
+    assert(arr[0] == first && arr.size() == writers * per_writer + 100000);
+
+    //Copies clone, lvalue pointers are cloned too
+    PtrArray<Base> source(new Derived1(1), new Derived2(2));
+    ConcurrentPtrArray<Base> copy(source);
+    assert(copy.size() == 2 && copy[1]->getValue() == 2 && copy[0] != source[0]);
+    Base* elem = source[0];
+    copy.push_back(elem);
+    assert(copy.at(2).getValue() == 1 && copy[2] != elem);
+
+    copy.clear();
+    assert(copy.empty());
+    copy.reserve(1000);
+    copy.emplace_back(new Derived1(5), std::make_unique<Derived2>(6));
+    assert(copy.size() == 2 && copy[1]->getValue() == 6);
+}
+
+static void test_rcu_snapshots() {
+    RcuPtrArray<Base> arr;
+    assert(arr.snapshot().empty());
+
+    //A snapshot keeps its version while the writer moves on
+    arr.emplace_back(new Derived1(1), new Derived2(2));
+    {
+        auto snapshot = arr.snapshot();
+        arr.erase_if([](Base const* b) { return b->getValue() == 1; });
+        arr.push_back(static_cast<Base*>(new Derived1(3)));
+
+        assert(snapshot.size() == 2 && snapshot[0]->getValue() == 1 && snapshot[1]->getValue() == 2);
+        assert(arr.size() == 2 && arr.snapshot()[1]->getValue() == 3);
+    }
+    EpochDomain::instance().synchronize();
+
+    //A bulk load goes through one update(), which publishes once
+    arr.clear();
+    {
+        auto before = arr.snapshot();
+        arr.update([](RcuPtrArray<Base>::array_type& writer) {
+            writer.reserve(1000);
+            for (int i = 0; i < 1000; ++i)
+                writer.emplace_back(new Derived1(i));
+        });
+
+        auto after = arr.snapshot();
+        assert(before.empty() && after.size() == 1000 && after[999]->getValue() == 999);
+    }
+    arr.clear();
+    EpochDomain::instance().synchronize();
+
+    //Readers walk snapshots while the writer inserts, erases and clears; values are always ascending
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r)
+        readers.emplace_back([&] {
+            while (!done)
+            {
+                auto snapshot = arr.snapshot();
+                int previous = -1;
+                for (Base const* elem : snapshot)
+                {
+                    assert(elem->getValue() > previous);
+                    previous = elem->getValue();
+                }
+            }
+        });
+
+    int next = 4;
+    for (int round = 0; round < 300; ++round)
+    {
+        arr.update([&](RcuPtrArray<Base>::array_type& writer) {
+            for (int i = 0; i < 20; ++i)
+                writer.emplace_back(new Derived1(next++));
+        });
+        arr.erase_if([](Base const* b) { return b->getValue() % 3 == 0; });
+
+        if (round % 100 == 99)
+            arr.clear();
+    }
+
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+
+    assert(arr.size() == 0);
+    EpochDomain::instance().synchronize();
+    assert(EpochDomain::instance().pending() == 0);
+}
+
+static void test_slot_handles() {
+    SlotPtrArray<Base> arr;
+    using Handle = SlotPtrArray<Base>::Handle;
+
+    //Handles survive erasing the other elements
+    std::vector<Handle> handles;
+    for (int i = 0; i < 100; ++i)
+        handles.push_back(i % 2 ? arr.insert(static_cast<Base*>(new Derived1(i))) : arr.emplace_new<Derived2>(i));
+
+    for (int i = 0; i < 100; i += 3)
+        assert(arr.erase(handles[i]));
+    assert(arr.size() == 100 - 34);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        if (i % 3 == 0)
+            assert(!arr.get(handles[i]) && !arr.contains(handles[i]) && !arr.erase(handles[i]));
+        else
+            assert(arr.get(handles[i])->getValue() == i);
+    }
+
+    //Freed slots are reused with a new generation, old handles stay stale
+    Handle reused = arr.insert(static_cast<Base*>(new Derived1(1000)));
+    assert(reused.index == handles[99].index && reused.generation == 2);
+    assert(!arr.get(handles[99]) && arr.get(reused)->getValue() == 1000);
+
+    //Dense pass sees every element once, handle_at maps it back
+    int sum = 0;
+    for (Base* elem : arr)
+        sum += elem->getValue();
+    int expected = 1000;
+    for (int i = 0; i < 100; ++i)
+        if (i % 3)
+            expected += i;
+    assert(sum == expected);
+
+    for (size_t i = 0; i < arr.size(); ++i)
+        assert(arr.get(arr.handle_at(i)) == arr.dense()[i]);
+
+    assert(!arr.get(Handle{}) && !arr.get(Handle{ 5000, 1 }));
+
+    arr.clear();
+    assert(arr.empty() && !arr.get(reused) && !arr.get(handles[1]));
+    Handle fresh = arr.insert(static_cast<Base*>(new Derived2(7)));
+    assert(arr.get(fresh)->getValue() == 7 && arr.size() == 1);
+}
+
+static void test_prefetched_iteration() {
+    PtrArray<Base> arr;
+    for (int i = 0; i < 50000; ++i)
+        arr.emplace_back(new Derived1(i));
+
+    long long expected = 0;
+    for (Base* elem : arr)
+        expected += elem->getValue();
+
+    //Explicit, automatic and no distance
+    for (size_t distance : { size_t(8), prefetch_auto, size_t(0), size_t(100000) })
+    {
+        long long sum = 0;
+        arr.for_each_prefetched([&sum](Base const* elem) { sum += elem->getValue(); }, distance);
+        assert(sum == expected);
+
+        sum = 0;
+        for (Base* elem : prefetched(arr, distance))
+            sum += elem->getValue();
+        assert(sum == expected);
+    }
+
+    //Works over other ranges of pointers and keeps the order
+    std::vector<std::unique_ptr<Base>> owners;
+    for (int i = 0; i < 100; ++i)
+        owners.push_back(std::make_unique<Derived2>(i));
+
+    int next = 0;
+    for (auto& elem : prefetched(owners, 4))
+        assert(elem->getValue() == next++);
+    assert(next == 100);
+
+    PtrArray<Base> empty;
+    empty.for_each_prefetched([](Base*) { assert(false); });
+    for ([[maybe_unused]] Base* elem : prefetched(empty))
+        assert(false);
+}
+
+//Mutable pointee to check the rebuild hooks
+class Counter final : public Base {
+public:
+    explicit Counter(int a) : Base(a) { }
+
+    void set(int a) { this->field = a; }
+
+    void display() const override { std::cout << "Counter" << std::endl; }
+    Base* clone() const override { return new Counter(*this); }
+    Base* clone(Arena& arena) const override { return arena.create<Counter>(*this); }
+    size_t size_bytes() const override { return sizeof(Counter); }
+};
+
+static void test_indexed_array() {
+    IndexedPtrArray<Base, &Base::getValue> arr;
+    for (int i = 0; i < 1000; ++i)
+        arr.emplace_back(new Derived1(i % 100));
+
+    assert(arr.find(42) && arr.find(42)->getValue() == 42);
+    assert(arr.count(42) == 10 && !arr.contains(100));
+    for (Base* elem : arr.equal_range(7))
+        assert(elem->getValue() == 7);
+
+    //Erasing, inserting and assigning keep the index in step
+    arr.erase_if([](Base const* b) { return b->getValue() == 42; });
+    assert(!arr.find(42) && arr.count(42) == 0);
+
+    arr.emplace_front(new Derived2(500));
+    arr.emplace_new<Derived1>(arr.begin() + 10, 501);
+    Base* local = new Derived1(502);
+    arr.push_back(local);
+    assert(arr.find(500) && arr.find(501) && arr.count(502) == 1 && arr.find(502) != local);
+    delete local;
+
+    *arr.begin() = static_cast<Base*>(new Derived1(600));
+    assert(!arr.find(500) && arr.find(600) == arr[0]);
+
+    arr.pop_back();
+    assert(!arr.contains(502));
+
+    //Sorting moves the slots only
+    std::sort(arr.begin(), arr.end(), std::less<decltype(arr)::value_type>());
+    assert(arr.count(7) == 10 && arr.find(600) == arr[arr.size() - 1]);
+
+    //Copies have their own index
+    auto copy = arr;
+    assert(copy.count(7) == 10 && copy.find(7) != arr.find(7));
+    copy.clear();
+    assert(!copy.contains(7) && arr.count(7) == 10);
+
+    //Changing a pointee in place needs a reindex
+    IndexedPtrArray<Base, &Base::getValue> counters;
+    counters.emplace_back_new<Counter>(1);
+    counters.emplace_back_new<Counter>(2);
+    static_cast<Counter*>(counters[0])->set(10);
+    assert(counters.find(1) == counters[0] && !counters.find(10));
+    counters.reindex(counters[0]);
+    assert(counters.find(10) == counters[0] && !counters.find(1));
+
+    static_cast<Counter*>(counters[1])->set(20);
+    counters.reindex();
+    assert(counters.find(20) == counters[1] && !counters.find(2));
+    counters.erase(counters.begin());
+    assert(!counters.find(10) && counters.find(20));
+
+    //Moved-from arrays are empty and keep indexing what they are given
+    auto moved = std::move(counters);
+    assert(moved.find(20) && !counters.find(20) && !counters.contains(20) && counters.count(20) == 0);
+    assert(std::ranges::empty(counters.equal_range(20)));
+    counters.push_back(new Derived1(5));
+    assert(counters.size() == 1 && counters.find(5) == counters[0] && moved.count(5) == 0);
+
+    moved = std::move(counters);
+    assert(moved.find(5) && !moved.contains(20) && !counters.find(5));
+    counters.push_back(new Derived1(6));
+    assert(counters.find(6) == counters[0]);
+
+    //Unindexing is O(1) however many elements share a key
+    IndexedPtrArray<Base, &Base::getValue> same;
+    for (int i = 0; i < 50000; ++i)
+        same.emplace_back(new Derived1(1));
+    for (int i = 0; i < 25000; ++i)
+        same.pop_back();
+    assert(same.count(1) == 25000);
+    same.clear();
+    assert(same.count(1) == 0 && !same.contains(1));
+}
+
+static void test_serialization() {
+    PtrArray<Base> arr;
+    for (int i = 0; i < 1000; ++i)
+        if (i % 3) arr.emplace_back(new Derived1(i));
+        else arr.emplace_back(new Derived2(-i));
+    arr.emplace(arr.begin() + 5, static_cast<Base*>(nullptr));
+
+    std::stringstream stream;
+    arr.save(stream);
+
+    //Round trip keeps values, dynamic types and nullptrs
+    auto check = [&arr](auto const& loaded, size_t offset) {
+        assert(loaded.size() == arr.size() + offset);
+        for (size_t i = 0; i < arr.size(); ++i)
+        {
+            Base const* expected = arr[i];
+            Base const* actual = loaded[i + offset];
+            assert(!expected == !actual);
+            if (expected)
+                assert(typeid(*expected) == typeid(*actual) && expected->getValue() == actual->getValue());
+        }
+    };
+
+    PtrArray<Base> heap;
+    heap.emplace_back(new Derived1(-1));
+    heap.load(stream);
+    check(heap, 1);
+    assert(heap[0]->getValue() == -1);
+
+    //Straight into an arena
+    stream.clear();
+    stream.seekg(0);
+    PtrArray<Base, ArenaAllocator> arena{ ArenaAllocator() };
+    arena.load(stream);
+    check(arena, 0);
+    assert(arena.get_allocator().arena()->bytes_used() > 0);
+
+    //Truncated streams and unknown tags leave the array as it was
+    std::string bytes = stream.str();
+    for (size_t cut : { size_t(3), size_t(20), bytes.size() / 2, bytes.size() - 1 })
+    {
+        std::stringstream truncated(bytes.substr(0, cut));
+        bool thrown = false;
+        try { heap.load(truncated); }
+        catch (std::runtime_error const&) { thrown = true; }
+        assert(thrown && heap.size() == arr.size() + 1);
+    }
+
+    //Counts the stream cannot back are rejected, and a failed load gives back the memory it grew
+    auto header = [](uint64_t count, int32_t elements) {
+        std::stringstream out;
+        binary_write(out, serialization_magic);
+        binary_write(out, serialization_version);
+        binary_write<uint64_t>(out, count);
+        for (int32_t i = 0; i < elements; ++i)
+        {
+            binary_write<uint32_t>(out, 1);
+            binary_write<int32_t>(out, i);
+        }
+        return out;
+    };
+    size_t capacity = heap.capacity();
+    for (auto [count, elements] : { std::pair<uint64_t, int32_t>(uint64_t(1) << 61, 0), { uint64_t(-1), 3 }, { 1000, 3 }, { 1000, 600 } })
+    {
+        auto corrupted = header(count, elements);
+        bool thrown = false;
+        try { heap.load(corrupted); }
+        catch (std::exception const&) { thrown = true; }
+        assert(thrown && heap.size() == arr.size() + 1 && heap.capacity() == capacity);
+    }
+    heap.emplace_back(new Derived1(5));
+    heap.pop_back();
+
+    auto exact = header(600, 600);
+    PtrArray<Base> grown;
+    grown.load(exact);
+    assert(grown.size() == 600 && grown[599]->getValue() == 599);
+
+    std::stringstream unknown;
+    binary_write(unknown, serialization_magic);
+    binary_write(unknown, serialization_version);
+    binary_write<uint64_t>(unknown, 2);
+    binary_write<uint32_t>(unknown, 1);
+    binary_write<int32_t>(unknown, 5);
+    binary_write<uint32_t>(unknown, 77);
+    bool thrown = false;
+    try { arena.load(unknown); }
+    catch (std::runtime_error const&) { thrown = true; }
+    assert(thrown && arena.size() == arr.size());
+
+    //Types that are not registered cannot be saved
+    PtrArray<Base> flaky;
+    flaky.emplace_back_new<FlakyClone>(1);
+    thrown = false;
+    try { flaky.save(stream); }
+    catch (std::invalid_argument const&) { thrown = true; }
+    assert(thrown);
+
+    //Own registry
+    TypeRegistry<Base> registry;
+    registry.add<FlakyClone>(9,
+        [](std::ostream& out, FlakyClone const& obj) { binary_write<int32_t>(out, obj.getValue()); },
+        [](std::istream& in) { return FlakyClone(binary_read<int32_t>(in)); });
+    std::stringstream own;
+    flaky.save(own, registry);
+    PtrArray<Base> reloaded;
+    reloaded.load(own, registry);
+    assert(reloaded.size() == 1 && reloaded[0]->getValue() == 1 && typeid(*reloaded[0]) == typeid(FlakyClone));
+}
+
+static void test_mapped_array() {
+    auto path = std::filesystem::temp_directory_path() / "ptrarray_mapped_test.bin";
+    std::filesystem::remove(path);
+
+    {
+        MappedPtrArray<Base> arr(path);
+        assert(arr.empty());
+
+        //Enough elements to grow both the slot table and the file
+        for (int i = 0; i < 20000; ++i)
+            if (i % 2) arr.push_back(static_cast<Base*>(new Derived1(i)));
+            else arr.emplace_back(new Derived2(i));
+
+        Base* local = new Derived1(-5);
+        arr.push_back(local);
+        delete local;
+        arr.push_back(static_cast<Base*>(nullptr));
+
+        assert(arr.size() == 20002 && arr[20001] == nullptr && arr.at(20000).getValue() == -5);
+        arr.pop_back();
+        arr.set(3, static_cast<Base*>(new Derived2(333)));
+        arr.flush();
+    }
+
+    //Reopening restores values and dynamic types through the tags
+    {
+        MappedPtrArray<Base> arr(path);
+        assert(arr.size() == 20001);
+        for (int i = 0; i < 20000; ++i)
+        {
+            Base const* elem = arr[i];
+            int expected = i == 3 ? 333 : i;
+            assert(elem->getValue() == expected);
+            assert((i % 2 && i != 3) ? typeid(*elem) == typeid(Derived1) : typeid(*elem) == typeid(Derived2));
+        }
+        assert(arr[20000]->getValue() == -5);
+
+        //Iterators keep working while the file grows
+        auto first = arr.begin();
+        for (int i = 0; i < 5000; ++i)
+            arr.push_back(static_cast<Base*>(new Derived1(i)));
+        assert(first->getValue() == 0 && *(arr.end() - 1) == arr[25000]);
+
+        long long sum = 0;
+        for (Base const* elem : arr)
+            sum += elem->getValue();
+        assert(sum > 0);
+
+        assert(arr.cached() <= arr.cache_limit());
+
+        size_t used = arr.bytes_used();
+        arr.clear();
+        assert(arr.empty() && arr.bytes_used() < used);
+        arr.push_back(static_cast<Base*>(new Derived1(1)));
+    }
+
+    {
+        MappedPtrArray<Base> arr(path);
+        assert(arr.size() == 1 && arr[0]->getValue() == 1);
+    }
+
+    //Only the most recently accessed objects stay in memory
+    {
+        MappedPtrArray<Base> arr(path, TypeRegistry<Base>::instance(), 4);
+        for (int i = 0; i < 100; ++i)
+            arr.push_back(static_cast<Base*>(new Derived1(i)));
+        assert(arr.cached() == 4);
+
+        long long sum = 0;
+        for (Base const* elem : arr)
+        {
+            sum += elem->getValue();
+            assert(arr.cached() <= 4);
+        }
+        assert(sum == 1 + 99 * 100 / 2 && arr[1]->getValue() == 0);
+
+        arr.clear();
+        assert(arr.cached() == 0);
+        arr.push_back(static_cast<Base*>(new Derived1(1)));
+        arr.flush();
+    }
+
+    //Out of range indices are clamped like in PtrArray
+    {
+        MappedPtrArray<Base> arr(path);
+        assert(arr[5] == arr[0]);
+        arr.pop_back();
+        assert(arr[0] == nullptr && arr[5] == nullptr);
+        arr.push_back(static_cast<Base*>(new Derived1(7)));
+        arr.flush();
+    }
+
+    //A failed resize leaves the file mapped as it was
+    {
+        MappedFile file(path);
+        size_t size = file.size();
+        std::string head(file.data(), 64);
+
+        bool thrown = false;
+        try { file.resize(size_t(1) << 62); }
+        catch (std::system_error const&) { thrown = true; }
+        assert(thrown && file.size() == size && std::filesystem::file_size(path) == size);
+        assert(file.data() && std::string(file.data(), 64) == head);
+
+        file.resize(size * 2);
+        file.resize(size);
+        assert(file.size() == size && std::string(file.data(), 64) == head);
+    }
+
+    //Corrupted headers are refused on opening, corrupted slots and records on reading
+    auto corrupt = [&path](size_t position, uint64_t value) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(position);
+        binary_write(file, value);
+    };
+    auto read_at = [&path](size_t position) {
+        std::ifstream file(path, std::ios::binary);
+        file.seekg(position);
+        return binary_read<uint64_t>(file);
+    };
+    auto refused = [&path](auto&& use) {
+        bool thrown = false;
+        try { MappedPtrArray<Base> arr(path); use(arr); }
+        catch (std::runtime_error const&) { thrown = true; }
+        return thrown;
+    };
+
+    //Header is magic, version, length, capacity, table and end
+    size_t table = read_at(24);
+    uint64_t slot = read_at(table);
+    uint64_t capacity = read_at(16);
+    auto noop = [](auto&) { };
+    auto read = [](auto& arr) { return arr[0]; };
+
+    corrupt(8, capacity + 1);
+    assert(refused(noop));
+    corrupt(8, 1);
+    corrupt(16, uint64_t(1) << 62);
+    assert(refused(noop));
+    corrupt(16, capacity);
+    //A used part past the end of the file, as in a truncated one
+    uint64_t end = std::filesystem::file_size(path);
+    corrupt(32, end + 8);
+    assert(refused(noop));
+    corrupt(32, end);
+    corrupt(table, end + 100);
+    assert(!refused(noop) && refused(read));
+    corrupt(table, slot);
+    corrupt(slot, uint64_t(1) << 40);
+    assert(refused(read));
+
+    //Files of other formats are refused
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << "not an array at all, just text";
+        bool thrown = false;
+        try { MappedPtrArray<Base> arr(path); }
+        catch (std::runtime_error const&) { thrown = true; }
+        assert(thrown);
+    }
+
+    std::filesystem::remove(path);
+}
+
+static void test_stats() {
+    using counted = PtrArray<Base, HeapAllocator, GeometricGrowth<>, CountingStats>;
+
+    //Disabled stats leave the slots a single pointer and count nothing
+    static_assert(sizeof(PtrArray<Base>::Wrapper) == sizeof(Base*));
+    PtrArray<Base> plain;
+    plain.emplace_back(new Derived1(1));
+    assert(plain.stats() == PtrArrayStats{});
+
+    counted arr;
+    arr.reserve(8);
+    for (int i = 0; i < 8; ++i)
+        arr.emplace_back(new Derived1(i));
+
+    auto stats = arr.stats();
+    assert(stats.allocations == 1 && stats.reallocations == 0 && stats.peak_capacity == 8);
+    assert(stats.bytes_allocated == 8 * sizeof(counted::value_type));
+    assert(stats.adopted == 8 && stats.clones == 0 && stats.moved == 0);
+
+    //Growing reallocates, erasing in the middle shifts the shorter side
+    arr.emplace_back(new Derived1(8));
+    arr.erase(arr.begin() + 4);
+    stats = arr.stats();
+    assert(stats.reallocations == 1 && stats.peak_capacity == arr.capacity());
+    assert(stats.moved == 4 && stats.destroyed == 1);
+
+    //Assigning an lvalue pointer through the Wrapper clones it
+    Base* local = new Derived2(5);
+    *arr.begin() = local;
+    delete local;
+    stats = arr.stats();
+    assert(stats.clones == 1 && stats.destroyed == 2);
+
+    arr.emplace_new<Derived1>(arr.begin() + 4, 42);
+    stats = arr.stats();
+    assert(stats.constructed == 1 && stats.moved == 8 && arr.size() == 9);
+
+    //Copies count on their own, snapshots add up
+    counted copy(arr);
+    assert(copy.stats().clones == 9 && copy.stats().allocations == 1);
+    assert(arr.stats().clones == 1);
+
+    auto total = arr.stats() + copy.stats();
+    assert(total.clones == 10 && total.peak_capacity == arr.capacity());
+
+    //Wrappers copied out of the array are detached and not counted
+    counted::Wrapper detached = *copy.begin();
+    assert(copy.stats().clones == 9 && detached->getValue() == 5);
+
+    //Clones made concurrently are counted too
+    counted parallel;
+    parallel.clone_from(copy, ThreadPool::instance());
+    assert(parallel.stats().clones == 9);
+
+    //Counters travel with the elements
+    counted moved(std::move(arr));
+    assert(moved.stats().clones == 1 && arr.stats() == PtrArrayStats{});
+    moved.clear();
+    assert(moved.stats().destroyed == 11);
+
+    moved.get_stats().reset();
+    assert(moved.stats() == PtrArrayStats{});
+}
+
+static void test_variant_array() {
+    using array_type = VariantPtrArray<Base, Derived1, Derived2>;
+
+    //Rvalue pointers are consumed, lvalue ones are copied
+    array_type arr(new Derived1(1), new Derived2(2));
+    Derived1 local(3);
+    Base* lvalue = &local;
+    arr.push_back(lvalue);
+    arr.emplace_back_new<Derived2>(4);
+    arr.emplace_new<Derived1>(arr.begin(), 0);
+    arr.emplace(arr.begin() + 2, new Derived2(10), new Derived1(11));
+
+    assert(arr.size() == 7 && local.getValue() == 3);
+    std::vector<int> values;
+    for (Base const* elem : arr)
+        values.push_back(elem->getValue());
+    assert((values == std::vector<int>{ 0, 1, 10, 11, 2, 3, 4 }));
+
+    //Elements live by value in one buffer
+    assert(std::holds_alternative<Derived2>(arr.variants()[2]));
+    assert(typeid(*arr[2]) == typeid(Derived2) && arr.at(3).getValue() == 11);
+    assert(std::ranges::count_if(arr, [](Base const* obj) { return obj->getValue() > 2; }) == 4);
+
+    //Visitation sees the concrete types
+    int derived1_sum = 0, derived2_sum = 0;
+    arr.for_each([&](auto const& obj) {
+        if constexpr (std::is_same_v<std::remove_cvref_t<decltype(obj)>, Derived1>) derived1_sum += obj.getValue();
+        else derived2_sum += obj.getValue(); });
+    assert(derived1_sum == 15 && derived2_sum == 16);
+    assert(arr.visit(2, [](auto const& obj) { return obj.getValue(); }) == 10);
+
+    //Copies are plain copies of the variants
+    array_type copy = arr;
+    arr.erase(arr.begin() + 2, arr.begin() + 4);
+    assert(arr.size() == 5 && arr[2]->getValue() == 2);
+    assert(copy.size() == 7 && copy[2]->getValue() == 10);
+
+    assert(arr.erase_if([](Base const* obj) { return obj->getValue() % 2; }) == 2);
+    assert(arr.size() == 3 && arr[1]->getValue() == 2);
+
+    //Types outside of the set and null pointers are refused, nothing is inserted
+    bool thrown = false;
+    try { arr.emplace_back(new Derived1(5), new Counter(6)); }
+    catch (std::invalid_argument const&) { thrown = true; }
+    assert(thrown && arr.size() == 3);
+
+    thrown = false;
+    try { arr.push_back(static_cast<Base*>(nullptr)); }
+    catch (std::invalid_argument const&) { thrown = true; }
+    assert(thrown && arr.size() == 3);
+
+    //A bad argument in the middle neither leaks nor half-consumes the others, every rvalue is deleted
+    VariantPtrArray<Base, Derived1, FlakyClone> flaky;
+    int alive = FlakyClone::alive;
+    FlakyClone kept(7);
+    Base* kept_ptr = &kept;
+    thrown = false;
+    try { flaky.emplace_back(new FlakyClone(1), kept_ptr, new Counter(2), new FlakyClone(3), static_cast<Base*>(nullptr)); }
+    catch (std::invalid_argument const&) { thrown = true; }
+    assert(thrown && flaky.empty() && FlakyClone::alive == alive + 1 && kept.getValue() == 7);
+
+    flaky.emplace_back(new FlakyClone(1), kept_ptr);
+    assert(flaky.size() == 2 && flaky[1]->getValue() == 7 && FlakyClone::alive == alive + 3);
+
+    thrown = false;
+    try { arr.at(3); }
+    catch (std::out_of_range const&) { thrown = true; }
+    assert(thrown);
+
+    arr.pop_front();
+    arr.pop_back();
+    assert(arr.size() == 1 && arr[0]->getValue() == 2);
+    arr.clear();
+    assert(arr.empty() && arr[0] == nullptr);
+}
+
+static void test_small_array() {
+    using array_type = SmallPtrArray<Base, 4>;
+
+    //Up to N elements stay inside the object
+    array_type arr(new Derived1(2), new Derived1(4));
+    Derived2 local(3);
+    Base* lvalue = &local;
+    arr.emplace(arr.begin() + 1, lvalue);
+    arr.push_front(new Derived2(1));
+    assert(arr.is_inline() && arr.size() == 4 && arr.capacity() == 4);
+    for (int i = 0; i < 4; ++i)
+        assert(arr[i]->getValue() == i + 1);
+
+    std::ranges::sort(arr, std::greater(), [](Base const* obj) { return obj->getValue(); });
+    assert(arr[0]->getValue() == 4 && arr.at(3).getValue() == 1);
+
+    arr.erase(arr.begin() + 1);
+    arr.pop_back();
+    assert(arr.size() == 2 && arr[0]->getValue() == 4 && arr[1]->getValue() == 2);
+
+    //Copies of inline arrays are inline and deep
+    array_type copy = arr;
+    assert(copy.is_inline() && copy[0] != arr[0] && copy[0]->getValue() == 4);
+
+    //Growing past N spills into the heap once, the pointers are moved as they are
+    Base* first = arr[0];
+    arr.emplace_back(new Derived1(5), new Derived1(6), new Derived1(7));
+    assert(!arr.is_inline() && arr.size() == 5 && arr.capacity() >= 5);
+    assert(arr[0] == first && arr[4]->getValue() == 7);
+
+    //Moving a spilled array moves the heap array
+    auto slot = &*arr.begin();
+    array_type moved = std::move(arr);
+    assert(&*moved.begin() == slot && arr.empty() && arr.is_inline());
+
+    //Moving an inline array moves its slots
+    array_type moved_inline = std::move(copy);
+    assert(moved_inline.is_inline() && moved_inline.size() == 2 && copy.empty());
+
+    moved_inline = moved;
+    assert(!moved_inline.is_inline() && moved_inline.size() == 5 && moved_inline[0] != moved[0]);
+
+    //Arena pointees are handed over to the heap array without cloning
+    SmallPtrArray<Base, 2, ArenaAllocator> arena_arr;
+    arena_arr.emplace_back(new Derived1(1), new Derived2(2));
+    size_t used = arena_arr.get_allocator().arena()->bytes_used();
+    first = arena_arr[0];
+    arena_arr.push_back(new Derived1(3));
+    assert(!arena_arr.is_inline() && arena_arr[0] == first);
+    assert(arena_arr.get_allocator().arena()->bytes_used() == used + sizeof(Derived1));
+
+    std::vector<Base*> range{ new Derived1(8), new Derived1(9) };
+    SmallPtrArray<Base, 3> ranged;
+    ranged.push_back(new Derived1(7));
+    ranged.insert(ranged.end(), std::make_move_iterator(range.begin()), std::make_move_iterator(range.end()));
+    assert(ranged.is_inline() && ranged.size() == 3 && ranged[2]->getValue() == 9);
+    ranged.clear();
+    assert(ranged.empty() && ranged[0] == nullptr);
+
+    //insert returns the first inserted element on both paths
+    std::vector<Base*> sources{ new FlakyClone(1), new FlakyClone(2), new FlakyClone(3), new FlakyClone(4) };
+    FlakyClone::clone_budget = 10;
+    ranged.push_back(new Derived1(0));
+    ranged.push_back(new Derived1(5));
+    assert(ranged.insert(ranged.begin() + 1, sources.begin(), sources.begin() + 1)->getValue() == 1);
+    assert(ranged.is_inline() && ranged[2]->getValue() == 5);
+    assert(ranged.insert(ranged.begin() + 1, sources.begin() + 1, sources.end())->getValue() == 2);
+    assert(!ranged.is_inline() && ranged.size() == 6 && ranged[4]->getValue() == 1 && ranged[5]->getValue() == 5);
+
+    //A throwing clone, after the spill as well, takes back every element of the range
+    SmallPtrArray<Base, 3> flaky;
+    flaky.push_back(new Derived1(0));
+    flaky.push_back(new Derived1(5));
+    int alive = FlakyClone::alive;
+    FlakyClone::clone_budget = 2;
+    try
+    {
+        flaky.insert(flaky.begin() + 1, sources.begin(), sources.end());
+        assert(false);
+    }
+    catch (std::runtime_error const&) { }
+    assert(flaky.size() == 2 && flaky[0]->getValue() == 0 && flaky[1]->getValue() == 5 && FlakyClone::alive == alive);
+
+    FlakyClone::clone_budget = 0;
+    try
+    {
+        flaky.insert(flaky.begin(), sources.begin(), sources.end());
+        assert(false);
+    }
+    catch (std::runtime_error const&) { }
+    assert(flaky.size() == 2 && flaky[0]->getValue() == 0 && FlakyClone::alive == alive);
+
+    for (Base* source : sources)
+        delete source;
+}
+
+//Builds, edits, copies and sums a StaticPtrArray, usable in constant expressions
+constexpr int static_array_sum() {
+    StaticPtrArray<Base, 4> arr(new Derived1(1), new Derived2(2));
+    arr.push_back(new Derived1(3));
+    arr.emplace_new<Derived2>(arr.begin(), 10);
+    arr.erase(arr.begin() + 1);
+
+    StaticPtrArray<Base, 4> copy = arr;
+    copy.pop_back();
+
+    int sum = 0;
+    for (Base const* elem : arr)
+        sum += elem->getValue();
+    for (Base const* elem : copy)
+        sum += elem->getValue();
+
+    return sum + int(arr.try_push_back(new Derived1(0))) * 100;
+}
+
+static void test_static_array() {
+    static_assert(static_array_sum() == 127);
+    assert(static_array_sum() == 127);
+
+    using array_type = StaticPtrArray<Base, 3>;
+    array_type arr(new Derived1(1), new Derived2(3));
+    Derived1 local(2);
+    Base* lvalue = &local;
+    arr.emplace(arr.begin() + 1, lvalue);
+    assert(arr.full() && arr.capacity() == 3 && arr[1] != lvalue);
+    for (int i = 0; i < 3; ++i)
+        assert(arr[i]->getValue() == i + 1);
+
+    //Overflow is reported or thrown, nothing is taken
+    Base* extra = new Derived1(4);
+    assert(!arr.try_push_back(std::move(extra)) && extra && arr.size() == 3);
+
+    bool thrown = false;
+    try { arr.push_back(std::move(extra)); }
+    catch (std::length_error const&) { thrown = true; }
+    assert(thrown && extra);
+    delete extra;
+
+    std::ranges::sort(arr, std::greater(), [](Base const* obj) { return obj->getValue(); });
+    assert(arr[0]->getValue() == 3 && arr.at(2).getValue() == 1);
+
+    //Prototypes cloned at runtime
+    array_type copy = arr;
+    assert(copy[0] != arr[0] && copy[0]->getValue() == 3 && typeid(*copy[0]) == typeid(Derived2));
+
+    array_type moved = std::move(copy);
+    assert(copy.empty() && moved.size() == 3);
+
+    arr.erase(arr.begin(), arr.begin() + 2);
+    assert(arr.size() == 1 && arr[0]->getValue() == 1);
+    arr.emplace_back_new<Derived2>(5);
+    arr.clear();
+    assert(arr.empty() && arr[0] == nullptr);
+}
+
+//Projection that counts its calls, to tell in-place column updates from rebuilds
+static size_t column_projections = 0;
+
+static int counted_value(Base const* obj) {
+    ++column_projections;
+    return obj->getValue();
+}
+
+static void test_column_array() {
+    ColumnPtrArray<Base, &counted_value> arr;
+    assert(arr.min() == arr.npos && arr.find(0) == arr.npos && arr.sum() == 0);
+
+    //1003 keys, so the SIMD loops have a tail
+    for (int i = 0; i < 1003; ++i)
+        if (i % 2) arr.emplace_back(new Derived1((i * 37) % 211 - 100));
+        else arr.emplace_back(new Derived2(-(i % 50)));
+
+    auto keys = [&arr] {
+        std::vector<int> keys;
+        for (Base const* elem : arr)
+            keys.push_back(elem->getValue());
+        return keys;
+    };
+    auto check = [&arr, &keys] {
+        auto expected = keys();
+        assert(std::ranges::equal(arr.column(), expected));
+        assert(arr.count(7) == size_t(std::ranges::count(expected, 7)));
+        assert(arr.count_if(KeyCompare::less, -20) == size_t(std::ranges::count_if(expected, [](int k) { return k < -20; })));
+        assert(arr.count_if(KeyCompare::not_equal, 0) == size_t(std::ranges::count_if(expected, [](int k) { return k != 0; })));
+        assert(arr.count_if(KeyCompare::greater_equal, 50) == size_t(std::ranges::count_if(expected, [](int k) { return k >= 50; })));
+
+        auto found = std::ranges::find(expected, 77);
+        assert(arr.find(77) == (found == expected.end() ? arr.npos : size_t(found - expected.begin())));
+        auto found_if = std::ranges::find_if(expected, [](int k) { return k > 95; });
+        assert(arr.find_if(KeyCompare::greater, 95) == (found_if == expected.end() ? arr.npos : size_t(found_if - expected.begin())));
+        assert(arr.find(5000) == arr.npos);
+
+        assert(arr.min() == size_t(std::ranges::min_element(expected) - expected.begin()));
+        assert(arr.max() == size_t(std::ranges::max_element(expected) - expected.begin()));
+        assert(arr.sum() == std::accumulate(expected.begin(), expected.end(), int64_t(0)));
+    };
+    check();
+
+    //Modifiers of the array update the column in place, one projection per new element
+    column_projections = 0;
+    arr.push_back(new Derived1(1000));
+    arr.emplace(arr.begin() + 3, new Derived1(-1000), new Derived2(500));
+    arr.emplace_new<Derived1>(arr.begin() + 100, 77);
+    arr.erase(arr.begin() + 10, arr.begin() + 20);
+    arr.pop_front();
+    arr.column();
+    assert(column_projections == 4);
+    assert(arr.max() == arr.size() - 1 && arr.min() == 2 && arr.find(77) <= 99);
+    check();
+
+    //Anything done through Wrappers marks it stale
+    column_projections = 0;
+    *(arr.begin() + 5) = static_cast<Base*>(new Derived1(-2000));
+    assert(arr.min() == 5 && column_projections == arr.size());
+    check();
+
+    std::ranges::sort(arr, std::less(), [](Base const* obj) { return obj->getValue(); });
+    assert(arr.min() == 0 && arr.max() == arr.size() - 1);
+    check();
+
+    arr.sort_by(&Base::getValue, std::greater());
+    assert(arr.max() == 0);
+    check();
+
+    arr.erase_if([](Base const* obj) { return obj->getValue() < 0; });
+    assert(arr.count_if(KeyCompare::less, 0) == 0);
+    check();
+
+    //Copies have their own column
+    auto copy = arr;
+    copy.clear();
+    assert(copy.column().empty() && copy.max() == copy.npos && arr.count(1000) == 1);
+
+    //Changing a pointee in place needs an invalidate
+    ColumnPtrArray<Base, &Base::getValue> counters;
+    counters.emplace_back_new<Counter>(1);
+    counters.emplace_back_new<Counter>(2);
+    assert(counters.max() == 1);
+    static_cast<Counter*>(counters[0])->set(10);
+    assert(counters.max() == 1);
+    counters.invalidate();
+    assert(counters.max() == 0 && counters.sum() == 12);
+
+    auto moved = std::move(counters);
+    moved.push_back(new Counter(20));
+    assert(moved.max() == 2 && moved.find(2) == 1);
+
+    //Moved-from arrays are empty and keep their column in step
+    assert(counters.column().empty() && counters.max() == counters.npos && counters.count(2) == 0 && counters.sum() == 0);
+    counters.push_back(new Derived1(5));
+    counters.push_back(new Derived1(7));
+    assert(counters.size() == 2 && counters.count(5) == 1 && counters.max() == 1 && counters.sum() == 12);
+
+    moved = std::move(counters);
+    assert(moved.size() == 2 && moved.find(7) == 1 && moved.sum() == 12);
+    counters.push_back(new Derived1(3));
+    assert(counters.count(3) == 1 && counters.min() == 0 && counters.sum() == 3);
+}
+
+static void test_foreign_wrappers() {
+    //Same allocator, other stats policy: pointers are handed over as they are
+    PtrArray<Base, HeapAllocator, GeometricGrowth<>, CountingStats> counted;
+    for (int i = 0; i < 10; ++i)
+        counted.emplace_back(new Derived1(i));
+
+    Base* first = counted[0];
+    PtrArray<Base> plain;
+    plain.insert(plain.end(), std::make_move_iterator(counted.begin()), std::make_move_iterator(counted.end()));
+    assert(plain.size() == 10 && plain[0] == first && !counted[0] && !counted[9]);
+    assert(plain[9]->getValue() == 9);
+
+    //Arena pointees are cloned onto the heap and destroyed by the arena's handle
+    PtrArray<Base, ArenaAllocator> arena_arr;
+    arena_arr.emplace_back(new Derived1(20));
+    arena_arr.emplace_back(new Derived2(21));
+    Base* in_arena = arena_arr[1];
+    plain.append_range(std::ranges::subrange(std::make_move_iterator(arena_arr.begin()), std::make_move_iterator(arena_arr.end())));
+    assert(plain.size() == 12 && plain[11] != in_arena && !arena_arr[1]);
+    assert(plain[11]->getValue() == 21 && typeid(*plain[11]) == typeid(Derived2));
+
+    //Single elements and Wrapper assignment take the same path
+    plain.emplace_back(std::move(*counted.begin()));
+    *plain.begin() = std::move(*(arena_arr.begin() + 1));
+    assert(plain.size() == 13 && !plain[12] && !plain[0]);
+
+    //Lvalues are cloned and stay in the source
+    arena_arr.emplace_back(new Derived1(30));
+    plain.emplace_back(*(arena_arr.begin() + 2));
+    assert(plain[13] != arena_arr[2] && plain[13]->getValue() == 30);
+
+    counted.clear();
+    arena_arr.clear();
+    assert(plain[1]->getValue() == 1 && plain[10]->getValue() == 20);
+}